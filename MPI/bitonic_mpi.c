@@ -1,17 +1,26 @@
+#include "../common/bitonic_io.h"
+#include "../common/bitonic_kernel.h"
+#include "../common/bitonic_bench.h"
+
 #include <mpi.h>
+#include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
 
-static int next_power_of_two(int n)
+// Sort engines: the hypercube compare-split exchange is the default; the
+// original gather-to-rank-0 merge is kept as a validation fallback.
+enum engine
 {
-    int p = 1;
-    while (p < n)
-    {
-        p <<= 1;
-    }
-    return p;
+    ENGINE_HYPERCUBE,
+    ENGINE_GATHER,
+    ENGINE_SAMPLESORT
+};
+
+static int is_power_of_two(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
 }
 
 static int int_compare(const void *a, const void *b)
@@ -25,258 +34,1508 @@ static int int_compare(const void *a, const void *b)
     return 0;
 }
 
-static int read_input_rank0(const char *path, int **data_out)
+// Bitonic comparator: compare two elements and optionally swap based on direction.
+// direction = 1 means ascending, 0 means descending.
+static void compare_and_swap(int *a, int *b, int direction)
+{
+    if ((direction == 1 && *a > *b) || (direction == 0 && *a < *b))
+    {
+        int tmp = *a;
+        *a = *b;
+        *b = tmp;
+    }
+}
+
+// Bitonic merge: merge two bitonic sequences into a single bitonic sequence.
+static void bitonic_merge(int *data, int start, int size, int direction)
+{
+    if (size > 1)
+    {
+        int mid = size / 2;
+        for (int i = start; i < start + mid; ++i)
+        {
+            compare_and_swap(&data[i], &data[i + mid], direction);
+        }
+        bitonic_merge(data, start, mid, direction);
+        bitonic_merge(data, start + mid, mid, direction);
+    }
+}
+
+// Below this size the recursion switches to a directed insertion sort,
+// which beats the comparator cascade once a subproblem fits in L1.
+#define BITONIC_SMALL_SORT 64
+
+static void insertion_sort_dir(int *data, int start, int size, int direction)
+{
+    for (int i = start + 1; i < start + size; ++i)
+    {
+        int value = data[i];
+        int j = i - 1;
+        while (j >= start && ((direction == 1) ? data[j] > value : data[j] < value))
+        {
+            data[j + 1] = data[j];
+            --j;
+        }
+        data[j + 1] = value;
+    }
+}
+
+// Bitonic sort: sort array into bitonic sequence.
+static void bitonic_sort_recursive(int *data, int start, int size, int direction)
+{
+    if (size > 1)
+    {
+        if (size <= BITONIC_SMALL_SORT)
+        {
+            insertion_sort_dir(data, start, size, direction);
+            return;
+        }
+
+        int mid = size / 2;
+        // Sort first half in ascending order
+        bitonic_sort_recursive(data, start, mid, 1);
+        // Sort second half in descending order
+        bitonic_sort_recursive(data, start + mid, mid, 0);
+        // Merge entire sequence in desired direction
+        bitonic_merge(data, start, size, direction);
+    }
+}
+
+// Task-parallel form of the recursive network: both halves at every level
+// are independent, so they fork as OpenMP tasks until the cutoff and the
+// runtime's work stealing balances the tree across cores — no assumption
+// that local_n divides evenly over the thread count.
+#define BITONIC_TASK_CUTOFF (1 << 14)
+
+static void bitonic_merge_task(int *data, int start, int size, int direction)
+{
+    int mid = size / 2;
+    for (int i = start; i < start + mid; ++i)
+    {
+        compare_and_swap(&data[i], &data[i + mid], direction);
+    }
+    if (mid <= BITONIC_TASK_CUTOFF)
+    {
+        bitonic_merge(data, start, mid, direction);
+        bitonic_merge(data, start + mid, mid, direction);
+        return;
+    }
+#pragma omp task
+    bitonic_merge_task(data, start, mid, direction);
+#pragma omp task
+    bitonic_merge_task(data, start + mid, mid, direction);
+#pragma omp taskwait
+}
+
+static void bitonic_sort_task(int *data, int start, int size, int direction)
+{
+    if (size <= BITONIC_TASK_CUTOFF)
+    {
+        bitonic_sort_recursive(data, start, size, direction);
+        return;
+    }
+    int mid = size / 2;
+#pragma omp task
+    bitonic_sort_task(data, start, mid, 1);
+#pragma omp task
+    bitonic_sort_task(data, start + mid, mid, 0);
+#pragma omp taskwait
+    bitonic_merge_task(data, start, size, direction);
+}
+
+// Task-based local phase (--local-sort=tasks): the largest power-of-two
+// prefix goes through the task network while the remainder is qsorted as a
+// sibling task, then one threaded merge joins the two sorted pieces.
+static void local_sort_tasks(int *data, int n)
+{
+    int prefix = 1;
+    while (prefix * 2 <= n)
+    {
+        prefix <<= 1;
+    }
+    int rest = n - prefix;
+
+#pragma omp parallel
+#pragma omp single
+    {
+#pragma omp task
+        bitonic_sort_task(data, 0, prefix, 1);
+        if (rest > 0)
+        {
+#pragma omp task
+            qsort(data + prefix, rest, sizeof(int), int_compare);
+        }
+    }
+
+    if (rest > 0)
+    {
+        int *tmp = malloc(n * sizeof(int));
+        if (!tmp)
+        {
+            fprintf(stderr, "Memory allocation failed during local sort\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        merge_sorted_parallel(data, prefix, data + prefix, rest, tmp);
+        memcpy(data, tmp, n * sizeof(int));
+        free(tmp);
+    }
+}
+
+static int local_sort_use_tasks = 0;
+
+// Local-phase sort. Only the inter-rank exchange needs the bitonic
+// structure, so each rank sorts its slice in n log n: per-thread qsort runs
+// followed by log(threads) rounds of pairwise merges.
+static void local_sort(int *data, int n)
+{
+    if (local_sort_use_tasks && n > 1)
+    {
+        local_sort_tasks(data, n);
+        return;
+    }
+    int num_threads = omp_get_max_threads();
+    if (num_threads == 1 || n < 2 * BITONIC_SMALL_SORT)
+    {
+        qsort(data, n, sizeof(int), int_compare);
+        return;
+    }
+
+    int chunk = (n + num_threads - 1) / num_threads;
+
+#pragma omp parallel for schedule(static)
+    for (int t = 0; t < num_threads; ++t)
+    {
+        int begin = t * chunk;
+        if (begin < n)
+        {
+            int len = n - begin < chunk ? n - begin : chunk;
+            qsort(data + begin, len, sizeof(int), int_compare);
+        }
+    }
+
+    int *tmp = malloc(n * sizeof(int));
+    if (!tmp)
+    {
+        fprintf(stderr, "Memory allocation failed during local sort\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    int *src = data;
+    int *dst = tmp;
+    for (int width = chunk; width < n; width *= 2)
+    {
+        for (int base = 0; base < n; base += 2 * width)
+        {
+            int left = n - base < width ? n - base : width;
+            int right = n - base - left;
+            if (right > 2 * width - left)
+            {
+                right = 2 * width - left;
+            }
+            if (right > 0)
+            {
+                merge_sorted_parallel(src + base, left, src + base + left, right, dst + base);
+            }
+            else if (left > 0)
+            {
+                memcpy(dst + base, src + base, left * sizeof(int));
+            }
+        }
+        int *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != data)
+    {
+        memcpy(data, src, n * sizeof(int));
+    }
+    free(tmp);
+}
+
+// --profile state: one record per compare-split step plus coarse phase
+// totals, reported at the end of the run with max/avg over ranks so the
+// straggler rank is visible. Each step splits its time into waiting on
+// MPI calls versus merging — a rank whose wait dominates is being held up
+// by a slow partner; one whose merge dominates is the slow node itself.
+#define MAX_PROFILE_STEPS 128
+
+struct step_profile
+{
+    int k;
+    int j;
+    int partner;
+    double seconds;
+    double wait_s;
+    double merge_s;
+    long bytes;
+};
+
+static int profile_enabled = 0;
+static struct step_profile profile_steps[MAX_PROFILE_STEPS];
+static int profile_step_count = 0;
+
+// Per-call accumulators, reset by distributed_bitonic around each step.
+static double exch_wait_s = 0.0;
+static double exch_merge_s = 0.0;
+
+// Scratch buffers reused by every merge_exchange step. Allocated and
+// page-faulted once after local_n is known, so the (log p)^2 exchange steps
+// do no allocator work and never touch cold pages.
+struct exchange_pool
+{
+    int *recv_buf;
+    int *merged;
+};
+
+static void exchange_pool_init(struct exchange_pool *pool, int local_n)
+{
+    pool->recv_buf = malloc(local_n * sizeof(int));
+    pool->merged = malloc(local_n * sizeof(int));
+    if (!pool->recv_buf || !pool->merged)
+    {
+        fprintf(stderr, "Memory allocation failed for exchange pool\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Pre-touch with the same static schedule the parallel merge uses, so
+    // first-touch places each page on the socket of the thread that will
+    // write it.
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < local_n; ++i)
+    {
+        pool->recv_buf[i] = 0;
+        pool->merged[i] = 0;
+    }
+}
+
+static void exchange_pool_free(struct exchange_pool *pool)
+{
+    free(pool->recv_buf);
+    free(pool->merged);
+    pool->recv_buf = NULL;
+    pool->merged = NULL;
+}
+
+// Pipelined exchange tuning: 64 KiB segments, at most 8 in flight per
+// step. Below two segments the blocking path is cheaper.
+#define EXCHANGE_SEGMENT (1 << 14)
+#define MAX_EXCHANGE_SEGMENTS 8
+
+// Compare-split with a partial exchange. Let A be the array of the rank
+// keeping the small half and B the partner's; both are sorted ascending.
+// Exactly s elements cross each way, where s is the largest count such that
+// the s smallest of B beat the s largest of A. Both ranks find s with a
+// distributed binary search that ships one boundary element per probe, then
+// transfer only the s crossing elements instead of the whole block.
+// Returns the number of elements that crossed ranks, for telemetry.
+static int merge_exchange(int *local, int local_n, int partner, int keep_small,
+                          struct exchange_pool *pool)
+{
+    int lo = 0;
+    int hi = local_n;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        // The small-keeper evaluates B[mid-1] < A[n-mid]; each side owns
+        // one of the two elements and fetches the other from its partner.
+        int mine = keep_small ? local[local_n - mid] : local[mid - 1];
+        int theirs;
+        double tw = profile_enabled ? MPI_Wtime() : 0.0;
+        MPI_Sendrecv(&mine, 1, MPI_INT, partner, 1,
+                     &theirs, 1, MPI_INT, partner, 1,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (profile_enabled)
+        {
+            exch_wait_s += MPI_Wtime() - tw;
+        }
+        int b_elem = keep_small ? theirs : mine;
+        int a_elem = keep_small ? mine : theirs;
+        if (b_elem < a_elem)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    int crossing = lo;
+
+    // Both ranks compute the same count, so returning early cannot
+    // deadlock. Already-ordered pairs cost only the probes.
+    if (crossing == 0)
+    {
+        return 0;
+    }
+
+    int *recv_buf = pool->recv_buf;
+    int *merged = pool->merged;
+
+    // The small-keeper gives up its s largest for the partner's s smallest;
+    // the large-keeper does the opposite. The send region and the kept
+    // region never overlap, so the merge can run while sends are in flight.
+    int *send_ptr = keep_small ? local + local_n - crossing : local;
+    const int *kept = keep_small ? local : local + crossing;
+    int kept_n = local_n - crossing;
+
+    if (crossing > 2 * EXCHANGE_SEGMENT)
+    {
+        // Pipelined transfer: the crossing elements go out in segments over
+        // non-blocking sends and receives, and the merge consumes segment c
+        // while segment c+1 is still on the wire. Matching same-tag
+        // messages arrive in posting order, so the segments land in place.
+        int seg_len = (crossing + MAX_EXCHANGE_SEGMENTS - 1) / MAX_EXCHANGE_SEGMENTS;
+        if (seg_len < EXCHANGE_SEGMENT)
+        {
+            seg_len = EXCHANGE_SEGMENT;
+        }
+        int nseg = (crossing + seg_len - 1) / seg_len;
+
+        MPI_Request send_req[MAX_EXCHANGE_SEGMENTS];
+        MPI_Request recv_req[MAX_EXCHANGE_SEGMENTS];
+        for (int s = 0; s < nseg; ++s)
+        {
+            int off = s * seg_len;
+            int len = crossing - off < seg_len ? crossing - off : seg_len;
+            MPI_Irecv(recv_buf + off, len, MPI_INT, partner, 0, MPI_COMM_WORLD, &recv_req[s]);
+            MPI_Isend(send_ptr + off, len, MPI_INT, partner, 0, MPI_COMM_WORLD, &send_req[s]);
+        }
+
+        // Incremental two-way merge from the small end: it can only advance
+        // through received values, so each segment's arrival unblocks the
+        // next stretch of output while later segments overlap with it.
+        int i = 0;
+        int r = 0;
+        int out = 0;
+        int ready = 0;
+        for (int s = 0; s < nseg; ++s)
+        {
+            int off = s * seg_len;
+            int len = crossing - off < seg_len ? crossing - off : seg_len;
+            double tw = profile_enabled ? MPI_Wtime() : 0.0;
+            MPI_Wait(&recv_req[s], MPI_STATUS_IGNORE);
+            if (profile_enabled)
+            {
+                double now = MPI_Wtime();
+                exch_wait_s += now - tw;
+                tw = now;
+            }
+            ready += len;
+            while (i < kept_n && r < ready)
+            {
+                merged[out++] = kept[i] <= recv_buf[r] ? kept[i++] : recv_buf[r++];
+            }
+            if (profile_enabled)
+            {
+                exch_merge_s += MPI_Wtime() - tw;
+            }
+        }
+        double tm = profile_enabled ? MPI_Wtime() : 0.0;
+        while (i < kept_n)
+        {
+            merged[out++] = kept[i++];
+        }
+        while (r < crossing)
+        {
+            merged[out++] = recv_buf[r++];
+        }
+        if (profile_enabled)
+        {
+            double now = MPI_Wtime();
+            exch_merge_s += now - tm;
+            tm = now;
+        }
+
+        MPI_Waitall(nseg, send_req, MPI_STATUSES_IGNORE);
+        if (profile_enabled)
+        {
+            exch_wait_s += MPI_Wtime() - tm;
+        }
+    }
+    else
+    {
+        // Small transfers: one blocking exchange plus the threaded merge
+        // beats pipelining overhead.
+        double tw = profile_enabled ? MPI_Wtime() : 0.0;
+        MPI_Sendrecv(send_ptr, crossing, MPI_INT, partner, 0,
+                     recv_buf, crossing, MPI_INT, partner, 0,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (profile_enabled)
+        {
+            double now = MPI_Wtime();
+            exch_wait_s += now - tw;
+            tw = now;
+        }
+        merge_sorted_parallel(kept, kept_n, recv_buf, crossing, merged);
+        if (profile_enabled)
+        {
+            exch_merge_s += MPI_Wtime() - tw;
+        }
+    }
+
+    memcpy(local, merged, local_n * sizeof(int));
+    return crossing;
+}
+
+static void distributed_bitonic(int *local, int local_n, int rank, int world_size,
+                                struct exchange_pool *pool)
+{
+    for (int k = 2; k <= world_size; k <<= 1)
+    {
+        for (int j = k >> 1; j > 0; j >>= 1)
+        {
+            int partner = rank ^ j;
+            // In an ascending region the lower rank of the pair keeps the
+            // small half, in a descending region the higher rank does.
+            int ascending = ((rank & k) == 0);
+            int keep_small = (rank < partner) == ascending;
+            double t0 = 0.0;
+            if (profile_enabled)
+            {
+                t0 = MPI_Wtime();
+                exch_wait_s = 0.0;
+                exch_merge_s = 0.0;
+            }
+            int crossing = merge_exchange(local, local_n, partner, keep_small, pool);
+            if (profile_enabled && profile_step_count < MAX_PROFILE_STEPS)
+            {
+                struct step_profile *sp = &profile_steps[profile_step_count++];
+                sp->k = k;
+                sp->j = j;
+                sp->partner = partner;
+                sp->seconds = MPI_Wtime() - t0;
+                sp->wait_s = exch_wait_s;
+                sp->merge_s = exch_merge_s;
+                sp->bytes = (long)crossing * (long)sizeof(int);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Sample-sort engine (--engine=samplesort): regular sampling picks p - 1
+// splitters from the sorted local slices, one MPI_Alltoallv moves every
+// element across the network exactly once, and the received runs are joined
+// with log p pairwise merges. Compare that to the hypercube exchange, which
+// moves elements up to (log p)^2 / 2 times. Regular sampling bounds any
+// rank's share at about 2n/p, but adversarially skewed keys can still load
+// one rank, which is why the bitonic engine stays the default. Works for
+// any process count.
+// ---------------------------------------------------------------------------
+
+// First index whose value is greater than v in a sorted array.
+static int upper_bound_int(const int *a, int n, int v)
+{
+    int lo = 0;
+    int hi = n;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (a[mid] <= v)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Sorts local_data globally across ranks; the caller takes ownership of
+// *out_data, whose length *out_n varies per rank with the key distribution.
+static void run_samplesort(int *local_data, int local_n, int rank, int world_size,
+                           int **out_data, int *out_n)
+{
+    int p = world_size;
+    int nsamp = p - 1;
+
+    local_sort(local_data, local_n);
+
+    // Regular samples of the sorted slice; gathered and re-sampled at rank
+    // 0 they bound every rank's final share at about 2n/p.
+    int *samples = malloc((nsamp > 0 ? nsamp : 1) * sizeof(int));
+    int *splitters = malloc((nsamp > 0 ? nsamp : 1) * sizeof(int));
+    int *all_samples = rank == 0 ? malloc((size_t)p * nsamp * sizeof(int) + 1) : NULL;
+    if (!samples || !splitters || (rank == 0 && !all_samples))
+    {
+        fprintf(stderr, "Memory allocation failed in samplesort\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < nsamp; ++i)
+    {
+        samples[i] = local_data[(long)(i + 1) * local_n / p];
+    }
+    MPI_Gather(samples, nsamp, MPI_INT, all_samples, nsamp, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0 && nsamp > 0)
+    {
+        qsort(all_samples, (size_t)p * nsamp, sizeof(int), int_compare);
+        for (int i = 0; i < nsamp; ++i)
+        {
+            splitters[i] = all_samples[(i + 1) * nsamp];
+        }
+    }
+    MPI_Bcast(splitters, nsamp, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // Splitter d bounds destination d's bucket from above; the slice is
+    // sorted, so each bucket is one contiguous range found by binary search.
+    int *send_counts = malloc(p * sizeof(int));
+    int *send_displs = malloc(p * sizeof(int));
+    int *recv_counts = malloc(p * sizeof(int));
+    int *recv_displs = malloc((p + 1) * sizeof(int));
+    if (!send_counts || !send_displs || !recv_counts || !recv_displs)
+    {
+        fprintf(stderr, "Memory allocation failed in samplesort\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int prev = 0;
+    for (int d = 0; d < p; ++d)
+    {
+        int bound = d < nsamp ? upper_bound_int(local_data, local_n, splitters[d]) : local_n;
+        send_displs[d] = prev;
+        send_counts[d] = bound - prev;
+        prev = bound;
+    }
+
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    int total = 0;
+    for (int s = 0; s < p; ++s)
+    {
+        recv_displs[s] = total;
+        total += recv_counts[s];
+    }
+    recv_displs[p] = total;
+
+    int *received = malloc((total > 0 ? total : 1) * sizeof(int));
+    if (!received)
+    {
+        fprintf(stderr, "Memory allocation failed in samplesort\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Alltoallv(local_data, send_counts, send_displs, MPI_INT,
+                  received, recv_counts, recv_displs, MPI_INT, MPI_COMM_WORLD);
+
+    // One sorted run per source rank, already delimited by the receive
+    // displacements; log p pairwise merge rounds join them.
+    merge_runs(received, total, recv_displs, p);
+
+    free(samples);
+    free(splitters);
+    free(all_samples);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    *out_data = received;
+    *out_n = total;
+}
+
+// Collective: every rank contributes its phase and step timings, rank 0
+// prints the report with per-rank max and average so skew stands out.
+static void profile_report(int rank, int world_size,
+                           double ingest_s, double local_s, double exchange_s, double output_s)
 {
-    FILE *fp = fopen(path, "r");
-    if (!fp)
+    static const char *phase_names[4] = {"ingest", "local_sort", "exchange", "output"};
+    double phases[4];
+    phases[0] = ingest_s;
+    phases[1] = local_s;
+    phases[2] = exchange_s;
+    phases[3] = output_s;
+
+    double pmax[4], psum[4];
+    MPI_Reduce(phases, pmax, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(phases, psum, 4, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    double step_secs[MAX_PROFILE_STEPS] = {0};
+    double step_wait[MAX_PROFILE_STEPS] = {0};
+    double step_merge[MAX_PROFILE_STEPS] = {0};
+    long step_bytes[MAX_PROFILE_STEPS] = {0};
+    double rank_totals[2] = {0.0, 0.0}; // total wait, total merge on this rank
+    for (int s = 0; s < profile_step_count; ++s)
+    {
+        step_secs[s] = profile_steps[s].seconds;
+        step_wait[s] = profile_steps[s].wait_s;
+        step_merge[s] = profile_steps[s].merge_s;
+        step_bytes[s] = profile_steps[s].bytes;
+        rank_totals[0] += profile_steps[s].wait_s;
+        rank_totals[1] += profile_steps[s].merge_s;
+    }
+    double smax[MAX_PROFILE_STEPS], ssum[MAX_PROFILE_STEPS];
+    double wmax[MAX_PROFILE_STEPS], mmax[MAX_PROFILE_STEPS];
+    long bsum[MAX_PROFILE_STEPS];
+    MPI_Reduce(step_secs, smax, profile_step_count, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(step_secs, ssum, profile_step_count, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(step_wait, wmax, profile_step_count, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(step_merge, mmax, profile_step_count, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(step_bytes, bsum, profile_step_count, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    // Gather every rank's per-step times and totals so rank 0 can name the
+    // straggler per step and print the wait-time distribution across ranks.
+    double *all_secs = NULL;
+    double *all_totals = NULL;
+    if (rank == 0)
     {
-        perror("Failed to open input file");
+        all_secs = malloc((size_t)world_size * MAX_PROFILE_STEPS * sizeof(double));
+        all_totals = malloc((size_t)world_size * 2 * sizeof(double));
+        if (!all_secs || !all_totals)
+        {
+            perror("malloc");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(step_secs, MAX_PROFILE_STEPS, MPI_DOUBLE,
+               all_secs, MAX_PROFILE_STEPS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather(rank_totals, 2, MPI_DOUBLE,
+               all_totals, 2, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("profile_csv,phase,name,max_s,avg_s\n");
+        for (int p = 0; p < 4; ++p)
+        {
+            printf("profile_csv,phase,%s,%.6f,%.6f\n",
+                   phase_names[p], pmax[p], psum[p] / world_size);
+        }
+        printf("profile_csv,step,k,j,max_s,avg_s,wait_max_s,merge_max_s,slowest_rank,total_bytes\n");
+        for (int s = 0; s < profile_step_count; ++s)
+        {
+            int slowest = 0;
+            for (int r = 1; r < world_size; ++r)
+            {
+                if (all_secs[(size_t)r * MAX_PROFILE_STEPS + s] >
+                    all_secs[(size_t)slowest * MAX_PROFILE_STEPS + s])
+                {
+                    slowest = r;
+                }
+            }
+            printf("profile_csv,step,%d,%d,%.6f,%.6f,%.6f,%.6f,%d,%ld\n",
+                   profile_steps[s].k, profile_steps[s].j,
+                   smax[s], ssum[s] / world_size, wmax[s], mmax[s], slowest, bsum[s]);
+        }
+        printf("profile_csv,rank,rank_id,total_wait_s,total_merge_s,steps_slowest\n");
+        for (int r = 0; r < world_size; ++r)
+        {
+            int slowest_count = 0;
+            for (int s = 0; s < profile_step_count; ++s)
+            {
+                int slowest = 0;
+                for (int q = 1; q < world_size; ++q)
+                {
+                    if (all_secs[(size_t)q * MAX_PROFILE_STEPS + s] >
+                        all_secs[(size_t)slowest * MAX_PROFILE_STEPS + s])
+                    {
+                        slowest = q;
+                    }
+                }
+                if (slowest == r)
+                {
+                    ++slowest_count;
+                }
+            }
+            printf("profile_csv,rank,%d,%.6f,%.6f,%d\n",
+                   r, all_totals[r * 2], all_totals[r * 2 + 1], slowest_count);
+        }
+        free(all_secs);
+        free(all_totals);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Key-payload mode: int64 keys carrying an int64 payload. The local phase
+// is a qsort on keys; the exchange steps ship whole blocks, since records
+// are rare enough here that the int path's partial exchange is not worth
+// duplicating yet.
+// ---------------------------------------------------------------------------
+
+static int kv_compare(const void *a, const void *b)
+{
+    const struct kv_record *lhs = a;
+    const struct kv_record *rhs = b;
+    if (lhs->key < rhs->key)
         return -1;
+    if (lhs->key > rhs->key)
+        return 1;
+    return 0;
+}
+
+static void merge_exchange_kv(struct kv_record *local, int local_n, int partner, int keep_small,
+                              struct kv_record *recv_buf, struct kv_record *merged,
+                              MPI_Datatype kv_type)
+{
+    MPI_Sendrecv(local, local_n, kv_type, partner, 0,
+                 recv_buf, local_n, kv_type, partner, 0,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    int i = 0, j = 0, m = 0;
+    while (i < local_n && j < local_n)
+    {
+        if (local[i].key <= recv_buf[j].key)
+        {
+            merged[m++] = local[i++];
+        }
+        else
+        {
+            merged[m++] = recv_buf[j++];
+        }
+    }
+    while (i < local_n)
+        merged[m++] = local[i++];
+    while (j < local_n)
+        merged[m++] = recv_buf[j++];
+
+    if (keep_small)
+    {
+        memcpy(local, merged, local_n * sizeof(*local));
+    }
+    else
+    {
+        memcpy(local, merged + local_n, local_n * sizeof(*local));
+    }
+}
+
+static int run_records_mode(const char *input_path, enum input_format format,
+                            enum input_format out_format, int engine,
+                            int rank, int world_size)
+{
+    struct kv_buffer kv = {0};
+    int original_count = 0;
+    int padded_count = 0;
+
+    if (rank == 0)
+    {
+        original_count = read_records(input_path, format, &kv);
+        if (original_count <= 0)
+        {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        padded_count = ((original_count + world_size - 1) / world_size) * world_size;
+        if (kv_buffer_pad(&kv, padded_count) != 0)
+        {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    MPI_Bcast(&original_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&padded_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int local_n = padded_count / world_size;
+    struct kv_record *local = malloc(local_n * sizeof(*local));
+    struct kv_record *recv_buf = malloc(local_n * sizeof(*recv_buf));
+    struct kv_record *merged = malloc(2 * local_n * sizeof(*merged));
+    if (!local || !recv_buf || !merged)
+    {
+        fprintf(stderr, "Rank %d failed to allocate record buffers\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Counted in records, not bytes: a byte count in int would overflow
+    // past ~134M records per rank.
+    MPI_Datatype kv_type;
+    MPI_Type_contiguous((int)sizeof(struct kv_record), MPI_BYTE, &kv_type);
+    MPI_Type_commit(&kv_type);
+
+    MPI_Scatter(kv.data, local_n, kv_type,
+                local, local_n, kv_type, 0, MPI_COMM_WORLD);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+
+    qsort(local, local_n, sizeof(*local), kv_compare);
+
+    if (engine == ENGINE_HYPERCUBE)
+    {
+        for (int k = 2; k <= world_size; k <<= 1)
+        {
+            for (int j = k >> 1; j > 0; j >>= 1)
+            {
+                int partner = rank ^ j;
+                int ascending = ((rank & k) == 0);
+                int keep_small = (rank < partner) == ascending;
+                merge_exchange_kv(local, local_n, partner, keep_small, recv_buf, merged, kv_type);
+            }
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double end = MPI_Wtime();
+
+    struct kv_record *all = NULL;
+    if (rank == 0)
+    {
+        all = malloc(padded_count * sizeof(*all));
+        if (!all)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(local, local_n, kv_type,
+               all, local_n, kv_type, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        if (engine == ENGINE_GATHER)
+        {
+            // Validation fallback: the gathered slices are each sorted but
+            // not globally ordered; finish on rank 0.
+            qsort(all, padded_count, sizeof(*all), kv_compare);
+        }
+
+        if (out_format == FORMAT_BIN)
+        {
+            write_records_binary("OutputFiles/mpi_output.bin", all, original_count);
+        }
+        else
+        {
+            write_records_text("OutputFiles/mpi_output.txt", all, original_count);
+        }
+        printf("Processes: %d\n", world_size);
+        printf("Threads per rank: %d\n", omp_get_max_threads());
+        printf("Engine: %s\n", engine == ENGINE_HYPERCUBE ? "hypercube" : "gather");
+        printf("Execution time (s): %.6f\n", end - start);
+        free(all);
+        kv_buffer_release(&kv);
+    }
+
+    MPI_Type_free(&kv_type);
+    free(local);
+    free(recv_buf);
+    free(merged);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+
+    int rank, world_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    const char *input_path = NULL;
+    const char *convert_path = NULL;
+    enum input_format format = FORMAT_AUTO;
+    enum input_format out_format = FORMAT_TXT;
+    int engine = ENGINE_HYPERCUBE;
+    int records_mode = 0;
+    int bench_reps = 0;
+    int top_k = 0;
+    int verify = 0;
+    const char *cache_dir = NULL;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (strcmp(argv[arg], "--engine=gather") == 0)
+        {
+            engine = ENGINE_GATHER;
+        }
+        else if (strcmp(argv[arg], "--engine=samplesort") == 0)
+        {
+            engine = ENGINE_SAMPLESORT;
+        }
+        else if (strcmp(argv[arg], "--engine=hypercube") == 0)
+        {
+            engine = ENGINE_HYPERCUBE;
+        }
+        else if (strcmp(argv[arg], "--format=bin") == 0)
+        {
+            format = FORMAT_BIN;
+        }
+        else if (strcmp(argv[arg], "--format=txt") == 0)
+        {
+            format = FORMAT_TXT;
+        }
+        else if (strncmp(argv[arg], "--convert=", 10) == 0)
+        {
+            convert_path = argv[arg] + 10;
+        }
+        else if (strcmp(argv[arg], "--output-format=bin") == 0)
+        {
+            out_format = FORMAT_BIN;
+        }
+        else if (strcmp(argv[arg], "--output-format=txt") == 0)
+        {
+            out_format = FORMAT_TXT;
+        }
+        else if (strcmp(argv[arg], "--records") == 0)
+        {
+            records_mode = 1;
+        }
+        else if (strcmp(argv[arg], "--profile") == 0)
+        {
+            profile_enabled = 1;
+        }
+        else if (strcmp(argv[arg], "--verify") == 0)
+        {
+            verify = 1;
+        }
+        else if (strncmp(argv[arg], "--cache=", 8) == 0)
+        {
+            cache_dir = argv[arg] + 8;
+        }
+        else if (strcmp(argv[arg], "--local-sort=tasks") == 0)
+        {
+            local_sort_use_tasks = 1;
+        }
+        else if (strcmp(argv[arg], "--local-sort=merge") == 0)
+        {
+            local_sort_use_tasks = 0;
+        }
+        else if (strncmp(argv[arg], "--top-k=", 8) == 0)
+        {
+            top_k = atoi(argv[arg] + 8);
+            if (top_k <= 0)
+            {
+                if (rank == 0)
+                {
+                    fprintf(stderr, "Invalid top-k count: %s\n", argv[arg] + 8);
+                }
+                MPI_Finalize();
+                return 1;
+            }
+        }
+        else if (strncmp(argv[arg], "--bench=", 8) == 0)
+        {
+            bench_reps = atoi(argv[arg] + 8);
+            if (bench_reps <= 0)
+            {
+                if (rank == 0)
+                {
+                    fprintf(stderr, "Invalid repetition count: %s\n", argv[arg] + 8);
+                }
+                MPI_Finalize();
+                return 1;
+            }
+        }
+        else if (strncmp(argv[arg], "--threads=", 10) == 0)
+        {
+            int threads = atoi(argv[arg] + 10);
+            if (threads > 0)
+            {
+                omp_set_num_threads(threads);
+            }
+        }
+        else if (strncmp(argv[arg], "--", 2) == 0)
+        {
+            if (rank == 0)
+            {
+                fprintf(stderr, "Unknown option: %s\n", argv[arg]);
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        else
+        {
+            input_path = argv[arg];
+        }
+    }
+
+    if (!input_path)
+    {
+        if (rank == 0)
+        {
+            fprintf(stderr, "Usage: %s [--engine=hypercube|gather] [--format=txt|bin] [--convert=out.bin] <input_file>\n", argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Converter mode: rank 0 rewrites the input in the binary container
+    // format; no sorting happens.
+    if (convert_path)
+    {
+        int rc = 0;
+        if (rank == 0)
+        {
+            struct input_buffer conv;
+            rc = read_input(input_path, format, &conv) <= 0 ? 1 : 0;
+            if (rc == 0)
+            {
+                rc = write_binary(convert_path, conv.data, conv.count) == 0 ? 0 : 1;
+                if (rc == 0)
+                {
+                    printf("Converted %d values to %s\n", conv.count, convert_path);
+                }
+                input_buffer_release(&conv);
+            }
+        }
+        MPI_Finalize();
+        return rc;
+    }
+
+    // The hypercube exchange pairs ranks via rank ^ j, so it needs a
+    // power-of-two communicator; fall back to the gather engine otherwise.
+    if (engine == ENGINE_HYPERCUBE && !is_power_of_two(world_size))
+    {
+        if (rank == 0)
+        {
+            fprintf(stderr, "Warning: %d processes is not a power of two, using gather engine\n", world_size);
+        }
+        engine = ENGINE_GATHER;
+    }
+
+    // Records mode only has hypercube and gather paths; samplesort would
+    // silently leave the gathered slices unmerged, so fall back instead.
+    if (records_mode && engine == ENGINE_SAMPLESORT)
+    {
+        if (rank == 0)
+        {
+            fprintf(stderr, "Warning: records mode does not support the samplesort engine, using gather engine\n");
+        }
+        engine = ENGINE_GATHER;
+    }
+
+    if (records_mode)
+    {
+        int rc = run_records_mode(input_path, format, out_format, engine, rank, world_size);
+        MPI_Finalize();
+        return rc;
+    }
+
+    // Opt-in result cache: rank 0 checks for an entry keyed by the input's
+    // identity and content; on a hit the whole parallel pipeline is skipped
+    // and rank 0 serves the cached artifact directly. Only the plain
+    // full-sort path may consult it — top-k and bench runs want their own
+    // work done, not a replayed artifact.
+    char cache_path[4096];
+    cache_path[0] = '\0';
+    if (cache_dir && top_k == 0 && bench_reps == 0)
+    {
+        int cache_hit = 0;
+        if (rank == 0)
+        {
+            char key[17];
+            if (compute_cache_key(input_path, key, sizeof(key)) == 0)
+            {
+                snprintf(cache_path, sizeof(cache_path), "%s/bitonic-%s.bin", cache_dir, key);
+                cache_hit = access(cache_path, R_OK) == 0;
+            }
+        }
+        MPI_Bcast(&cache_hit, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (cache_hit)
+        {
+            if (rank == 0)
+            {
+                double start = MPI_Wtime();
+                struct input_buffer cached;
+                int cached_count = read_input(cache_path, FORMAT_BIN, &cached);
+                if (cached_count > 0)
+                {
+                    if (out_format == FORMAT_BIN)
+                    {
+                        write_binary("OutputFiles/mpi_output.bin", cached.data, cached_count);
+                    }
+                    else
+                    {
+                        write_text_fast("OutputFiles/mpi_output.txt", cached.data, cached_count);
+                    }
+                    double end = MPI_Wtime();
+                    printf("Processes: %d\n", world_size);
+                    printf("Threads per rank: %d\n", omp_get_max_threads());
+                    printf("Execution time (s): %.6f\n", end - start);
+                    printf("Cache: hit\n");
+                    input_buffer_release(&cached);
+                }
+            }
+            MPI_Finalize();
+            return 0;
+        }
     }
 
-    int capacity = 1024;
-    int size = 0;
-    int *buffer = malloc(capacity * sizeof(int));
-    if (!buffer)
-    {
-        fclose(fp);
-        fprintf(stderr, "Memory allocation failed\n");
-        return -1;
-    }
+    // With the hypercube engine every rank ends up holding a sorted
+    // contiguous slice, so binary output can be written collectively with
+    // no rank-0 gather buffer at all.
+    int parallel_output = (engine == ENGINE_HYPERCUBE && out_format == FORMAT_BIN);
+
+    struct input_buffer input = {0};
+    int original_count = 0;
+    int padded_count = 0;
+    int local_n = 0;
+    int *local_data = NULL;
+    double t_ingest0 = MPI_Wtime();
 
-    while (1)
+    if ((format == FORMAT_AUTO ? detect_format(input_path) : format) == FORMAT_BIN)
     {
-        int value;
-        int scanned = fscanf(fp, "%d", &value);
-        if (scanned == 1)
+        // Parallel ingest: each rank reads only its slice of the shared
+        // binary file with collective MPI-IO, so there is no scatter and
+        // rank 0 never holds the full padded array.
+        MPI_File fh;
+        if (MPI_File_open(MPI_COMM_WORLD, input_path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
         {
-            if (size == capacity)
+            if (rank == 0)
             {
-                capacity *= 2;
-                int *tmp = realloc(buffer, capacity * sizeof(int));
-                if (!tmp)
-                {
-                    free(buffer);
-                    fclose(fp);
-                    fprintf(stderr, "Memory allocation failed\n");
-                    return -1;
-                }
-                buffer = tmp;
+                fprintf(stderr, "Failed to open input file: %s\n", input_path);
             }
-            buffer[size++] = value;
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        else if (scanned == EOF)
+
+        if (rank == 0)
         {
-            break;
+            struct bin_header hdr;
+            MPI_File_read_at(fh, 0, &hdr, sizeof(hdr), MPI_BYTE, MPI_STATUS_IGNORE);
+            if (memcmp(hdr.magic, BIN_MAGIC, 4) != 0 || hdr.version != BIN_VERSION || hdr.count > INT_MAX)
+            {
+                fprintf(stderr, "Not a valid binary input file: %s\n", input_path);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            // A truncated file would otherwise sort whatever the short
+            // collective read left uninitialized; reject it like the mmap
+            // loader does.
+            MPI_Offset file_size = 0;
+            MPI_File_get_size(fh, &file_size);
+            if (file_size != (MPI_Offset)sizeof(hdr) + (MPI_Offset)hdr.count * (MPI_Offset)sizeof(int))
+            {
+                fprintf(stderr, "Binary input header count does not match file size: %s\n", input_path);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            original_count = (int)hdr.count;
         }
-        else
+        MPI_Bcast(&original_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+        // Pad only to a multiple of the process count: non-power-of-two
+        // slices go through the arbitrary-n kernel, so the old
+        // next-power-of-two doubling is unnecessary.
+        padded_count = ((original_count + world_size - 1) / world_size) * world_size;
+
+        local_n = padded_count / world_size;
+        local_data = malloc(local_n * sizeof(int));
+        if (!local_data)
         {
-            free(buffer);
-            fclose(fp);
-            fprintf(stderr, "Invalid data in input file\n");
-            return -1;
+            fprintf(stderr, "Rank %d failed to allocate local buffer\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-    }
 
-    fclose(fp);
-    *data_out = buffer;
-    return size;
-}
+        // Ranks past the end of the real data read nothing (collective
+        // reads allow differing counts); the remainder is sentinel padding.
+        int start_elem = rank * local_n;
+        int avail = 0;
+        if (start_elem < original_count)
+        {
+            avail = original_count - start_elem;
+            if (avail > local_n)
+            {
+                avail = local_n;
+            }
+        }
+        MPI_Offset offset = (MPI_Offset)sizeof(struct bin_header) + (MPI_Offset)start_elem * sizeof(int);
+        MPI_File_read_at_all(fh, offset, local_data, avail, MPI_INT, MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
 
-// Bitonic comparator: compare two elements and optionally swap based on direction.
-// direction = 1 means ascending, 0 means descending.
-static void compare_and_swap(int *a, int *b, int direction)
-{
-    if ((direction == 1 && *a > *b) || (direction == 0 && *a < *b))
-    {
-        int tmp = *a;
-        *a = *b;
-        *b = tmp;
+        for (int i = avail; i < local_n; ++i)
+        {
+            local_data[i] = INT_MAX;
+        }
     }
-}
-
-// Bitonic merge: merge two bitonic sequences into a single bitonic sequence.
-static void bitonic_merge(int *data, int start, int size, int direction)
-{
-    if (size > 1)
+    else
     {
-        int mid = size / 2;
-        for (int i = start; i < start + mid; ++i)
+        if (rank == 0)
         {
-            compare_and_swap(&data[i], &data[i + mid], direction);
+            original_count = read_input(input_path, format, &input);
+            if (original_count <= 0)
+            {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+
+            // Same multiple-of-p padding as the MPI-IO branch; at most
+            // world_size - 1 sentinels instead of nearly doubling the array.
+            padded_count = ((original_count + world_size - 1) / world_size) * world_size;
+
+            if (input_buffer_pad(&input, padded_count) != 0)
+            {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
         }
-        bitonic_merge(data, start, mid, direction);
-        bitonic_merge(data, start + mid, mid, direction);
-    }
-}
 
-// Bitonic sort: sort array into bitonic sequence.
-static void bitonic_sort_recursive(int *data, int start, int size, int direction)
-{
-    if (size > 1)
-    {
-        int mid = size / 2;
-        // Sort first half in ascending order
-        bitonic_sort_recursive(data, start, mid, 1);
-        // Sort second half in descending order
-        bitonic_sort_recursive(data, start + mid, mid, 0);
-        // Merge entire sequence in desired direction
-        bitonic_merge(data, start, size, direction);
-    }
-}
+        MPI_Bcast(&original_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&padded_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-static void merge_exchange(int *local, int local_n, int partner, int ascending)
-{
-    int *recv_buf = malloc(local_n * sizeof(int));
-    int *merged = malloc(2 * local_n * sizeof(int));
-    if (!recv_buf || !merged)
-    {
-        fprintf(stderr, "Memory allocation failed during merge\n");
-        MPI_Abort(MPI_COMM_WORLD, 1);
+        local_n = padded_count / world_size;
+        local_data = malloc(local_n * sizeof(int));
+        if (!local_data)
+        {
+            fprintf(stderr, "Rank %d failed to allocate local buffer\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        MPI_Scatter(input.data, local_n, MPI_INT, local_data, local_n, MPI_INT, 0, MPI_COMM_WORLD);
     }
 
-    MPI_Sendrecv(local, local_n, MPI_INT, partner, 0,
-                 recv_buf, local_n, MPI_INT, partner, 0,
-                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    double ingest_s = MPI_Wtime() - t_ingest0;
 
-    int i = 0, j = 0, m = 0;
-    while (i < local_n && j < local_n)
+    // Partial sort: per-rank bounded-heap selection on the local slice,
+    // then a binomial-tree fold of the K-candidate lists toward rank 0.
+    // No local full sort, no (log p)^2 exchange, K values of output.
+    if (top_k > 0)
     {
-        if (local[i] <= recv_buf[j])
+        int k = top_k < original_count ? top_k : original_count;
+        int *smallest = malloc(k * sizeof(int));
+        int *theirs = malloc(k * sizeof(int));
+        int *folded = malloc(k * sizeof(int));
+        if (!smallest || !theirs || !folded)
         {
-            merged[m++] = local[i++];
+            fprintf(stderr, "Rank %d failed to allocate top-k buffers\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        else
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        int have = topk_select(local_data, local_n, k, smallest);
+
+        // Round r pairs ranks step apart; the higher one ships its
+        // candidates and drops out, so rank 0 holds the global K after
+        // ceil(log2 p) rounds regardless of whether p is a power of two.
+        for (int step = 1; step < world_size; step <<= 1)
         {
-            merged[m++] = recv_buf[j++];
+            if (rank & step)
+            {
+                MPI_Send(&have, 1, MPI_INT, rank - step, 2, MPI_COMM_WORLD);
+                MPI_Send(smallest, have, MPI_INT, rank - step, 3, MPI_COMM_WORLD);
+                break;
+            }
+            if (rank + step < world_size)
+            {
+                int their_n;
+                MPI_Recv(&their_n, 1, MPI_INT, rank + step, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Recv(theirs, their_n, MPI_INT, rank + step, 3, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                have = topk_merge(smallest, have, theirs, their_n, k, folded);
+                int *swap = smallest;
+                smallest = folded;
+                folded = swap;
+            }
         }
-    }
-    while (i < local_n)
-        merged[m++] = local[i++];
-    while (j < local_n)
-        merged[m++] = recv_buf[j++];
+        double elapsed = MPI_Wtime() - t0;
+        double slowest;
+        MPI_Reduce(&elapsed, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 
-    if (ascending)
-    {
-        // Ascending: keep smaller half
-        memcpy(local, merged, local_n * sizeof(int));
+        if (rank == 0)
+        {
+            printf("Processes: %d\n", world_size);
+            printf("Threads per rank: %d\n", omp_get_max_threads());
+            printf("Top-K: %d\n", have);
+            printf("Execution time (s): %.6f\n", slowest);
+            if (out_format == FORMAT_BIN)
+            {
+                write_binary("OutputFiles/mpi_output.bin", smallest, have);
+            }
+            else
+            {
+                write_text_fast("OutputFiles/mpi_output.txt", smallest, have);
+            }
+            input_buffer_release(&input);
+        }
+
+        free(smallest);
+        free(theirs);
+        free(folded);
+        free(local_data);
+        MPI_Finalize();
+        return 0;
     }
-    else
+
+    // Samplesort produces variable-length slices, so it runs its own
+    // timing and Gatherv-based output instead of the fixed-slice path.
+    if (engine == ENGINE_SAMPLESORT)
     {
-        // Descending: keep larger half in reverse order
-        for (int idx = 0; idx < local_n; ++idx)
+        if (bench_reps > 0 && rank == 0)
         {
-            local[idx] = merged[2 * local_n - 1 - idx];
+            fprintf(stderr, "Benchmark mode supports the hypercube and gather engines only\n");
         }
-    }
 
-    free(merged);
-    free(recv_buf);
-}
+        // Fingerprint the local slice before samplesort redistributes it;
+        // sentinel padding is part of both sides of the comparison.
+        struct verify_sums in_sums = {0, 0, 0};
+        if (verify)
+        {
+            in_sums = checksum_multiset(local_data, local_n);
+        }
 
-static void distributed_bitonic(int *local, int local_n, int rank, int world_size)
-{
-    for (int k = 2; k <= world_size; k <<= 1)
-    {
-        for (int j = k >> 1; j > 0; j >>= 1)
+        int *sorted = NULL;
+        int sorted_n = 0;
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        run_samplesort(local_data, local_n, rank, world_size, &sorted, &sorted_n);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double end = MPI_Wtime();
+
+        int *counts = rank == 0 ? malloc(world_size * sizeof(int)) : NULL;
+        int *displs = rank == 0 ? malloc(world_size * sizeof(int)) : NULL;
+        int *all = rank == 0 ? malloc(padded_count * sizeof(int)) : NULL;
+        if (rank == 0 && (!counts || !displs || !all))
         {
-            int partner = rank ^ j;
-            int ascending = ((rank & k) == 0);
-            merge_exchange(local, local_n, partner, ascending);
+            fprintf(stderr, "Memory allocation failed\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-    }
-}
+        MPI_Gather(&sorted_n, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (rank == 0)
+        {
+            int offset = 0;
+            for (int s = 0; s < world_size; ++s)
+            {
+                displs[s] = offset;
+                offset += counts[s];
+            }
+        }
+        MPI_Gatherv(sorted, sorted_n, MPI_INT, all, counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
 
-static void write_output_rank0(const char *path, const int *data, int count)
-{
-    FILE *fp = fopen(path, "w");
-    if (!fp)
-    {
-        perror("Failed to open output file");
-        return;
-    }
-    for (int i = 0; i < count; ++i)
-    {
-        fprintf(fp, "%d%s", data[i], (i + 1 == count) ? "" : " ");
-    }
-    fprintf(fp, "\n");
-    fclose(fp);
-}
+        // Slices are variable-length here, so the sortedness check runs on
+        // the gathered array like the gather engine's does.
+        int verify_failed = 0;
+        if (verify)
+        {
+            struct verify_sums out_sums = {0, 0, 0};
+            int sorted_ok = 1;
+            if (rank == 0)
+            {
+                out_sums = checksum_multiset(all, padded_count);
+                sorted_ok = count_descents(all, padded_count) == 0;
+            }
 
-int main(int argc, char **argv)
-{
-    MPI_Init(&argc, &argv);
+            uint64_t add_local[4] = {in_sums.sum, in_sums.sum_sq, out_sums.sum, out_sums.sum_sq};
+            uint64_t xor_local[2] = {in_sums.xor_all, out_sums.xor_all};
+            uint64_t add_total[4];
+            uint64_t xor_total[2];
+            int sorted_all;
+            MPI_Reduce(add_local, add_total, 4, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+            MPI_Reduce(xor_local, xor_total, 2, MPI_UINT64_T, MPI_BXOR, 0, MPI_COMM_WORLD);
+            MPI_Reduce(&sorted_ok, &sorted_all, 1, MPI_INT, MPI_LAND, 0, MPI_COMM_WORLD);
 
-    int rank, world_size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+            if (rank == 0)
+            {
+                struct verify_sums global_in = {add_total[0], xor_total[0], add_total[1]};
+                struct verify_sums global_out = {add_total[2], xor_total[1], add_total[3]};
+                int same_multiset = verify_sums_equal(global_in, global_out);
+                verify_failed = !sorted_all || !same_multiset;
+                printf("Verification: %s\n", verify_failed ? "FAIL" : "PASS");
+                if (!sorted_all)
+                {
+                    fprintf(stderr, "Verification failed: output is not sorted\n");
+                }
+                if (!same_multiset)
+                {
+                    fprintf(stderr, "Verification failed: output multiset differs from input\n");
+                }
+            }
+            MPI_Bcast(&verify_failed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        }
 
-    if (argc < 2)
-    {
         if (rank == 0)
         {
-            fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+            if (out_format == FORMAT_BIN)
+            {
+                write_binary("OutputFiles/mpi_output.bin", all, original_count);
+            }
+            else
+            {
+                write_text_fast("OutputFiles/mpi_output.txt", all, original_count);
+            }
+            printf("Processes: %d\n", world_size);
+            printf("Threads per rank: %d\n", omp_get_max_threads());
+            printf("Engine: samplesort\n");
+            printf("Execution time (s): %.6f\n", end - start);
+            free(counts);
+            free(displs);
+            free(all);
+            input_buffer_release(&input);
         }
+
+        free(sorted);
+        free(local_data);
         MPI_Finalize();
-        return 1;
+        return verify_failed ? 1 : 0;
     }
 
-    int *global_data = NULL;
-    int original_count = 0;
-    int padded_count = 0;
+    struct exchange_pool pool = {0};
+    if (engine == ENGINE_HYPERCUBE)
+    {
+        exchange_pool_init(&pool, local_n);
+    }
 
-    if (rank == 0)
+    // Benchmark mode: repetitions on locally reshuffled copies; the
+    // per-repetition time is the slowest rank's (the quantity users see).
+    if (bench_reps > 0)
     {
-        original_count = read_input_rank0(argv[1], &global_data);
-        if (original_count <= 0)
+        int *pristine = malloc(local_n * sizeof(int));
+        double *times = rank == 0 ? malloc(bench_reps * sizeof(double)) : NULL;
+        if (!pristine || (rank == 0 && !times))
         {
+            fprintf(stderr, "Memory allocation failed\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        memcpy(pristine, local_data, local_n * sizeof(int));
 
-        padded_count = next_power_of_two(original_count);
-        while (padded_count % world_size != 0)
+        // Warmup: one full untimed pass.
+        local_sort(local_data, local_n);
+        if (engine == ENGINE_HYPERCUBE)
         {
-            padded_count <<= 1;
+            distributed_bitonic(local_data, local_n, rank, world_size, &pool);
         }
 
-        int required = padded_count - original_count;
-        int *tmp = realloc(global_data, padded_count * sizeof(int));
-        if (!tmp)
+        for (int rep = 0; rep < bench_reps; ++rep)
         {
-            free(global_data);
-            fprintf(stderr, "Memory allocation failed\n");
-            MPI_Abort(MPI_COMM_WORLD, 1);
+            memcpy(local_data, pristine, local_n * sizeof(int));
+            shuffle_ints(local_data, local_n, (unsigned)(rank * 7919 + rep + 1));
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t0 = MPI_Wtime();
+            local_sort(local_data, local_n);
+            if (engine == ENGINE_HYPERCUBE)
+            {
+                distributed_bitonic(local_data, local_n, rank, world_size, &pool);
+            }
+            double elapsed = MPI_Wtime() - t0;
+
+            double slowest;
+            MPI_Reduce(&elapsed, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            if (rank == 0)
+            {
+                times[rep] = slowest;
+            }
         }
-        global_data = tmp;
-        for (int i = 0; i < required; ++i)
+
+        if (rank == 0)
         {
-            global_data[original_count + i] = INT_MAX;
+            struct bench_stats stats = bench_compute(times, bench_reps);
+            double melems = (double)original_count / stats.median / 1e6;
+            printf("bench_csv,impl,procs,threads,n,reps,min_s,median_s,mean_s,stddev_s,melems_per_s\n");
+            printf("bench_csv,mpi,%d,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.2f\n",
+                   world_size, omp_get_max_threads(), original_count, bench_reps,
+                   stats.min, stats.median, stats.mean, stats.stddev, melems);
+            free(times);
+            input_buffer_release(&input);
         }
-    }
 
-    MPI_Bcast(&original_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&padded_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        free(pristine);
+        if (engine == ENGINE_HYPERCUBE)
+        {
+            exchange_pool_free(&pool);
+        }
+        free(local_data);
+        MPI_Finalize();
+        return 0;
+    }
 
-    int local_n = padded_count / world_size;
-    int *local_data = malloc(local_n * sizeof(int));
-    if (!local_data)
+    // Fingerprint each rank's slice before sorting; sentinels are part of
+    // both fingerprints, so they cancel out in the comparison.
+    struct verify_sums in_sums = {0, 0, 0};
+    if (verify)
     {
-        fprintf(stderr, "Rank %d failed to allocate local buffer\n", rank);
-        MPI_Abort(MPI_COMM_WORLD, 1);
+        in_sums = checksum_multiset(local_data, local_n);
     }
 
-    MPI_Scatter(global_data, local_n, MPI_INT, local_data, local_n, MPI_INT, 0, MPI_COMM_WORLD);
-
     MPI_Barrier(MPI_COMM_WORLD);
     double start = MPI_Wtime();
 
-    // Each process sorts its local data
-    bitonic_sort_recursive(local_data, 0, local_n, 1);
+    // Each process sorts its local data with the threaded n log n engine;
+    // the bitonic structure is only needed between ranks.
+    double t_local0 = MPI_Wtime();
+    local_sort(local_data, local_n);
+    double local_s = MPI_Wtime() - t_local0;
 
-    // Now perform a simple merge-based distributed sort
-    // All processes send their sorted data to rank 0, which merges them
     int *all_data = NULL;
-    if (rank == 0)
+    if (rank == 0 && !parallel_output)
     {
         all_data = malloc(padded_count * sizeof(int));
         if (!all_data)
@@ -286,9 +1545,21 @@ int main(int argc, char **argv)
         }
     }
 
-    MPI_Gather(local_data, local_n, MPI_INT, all_data, local_n, MPI_INT, 0, MPI_COMM_WORLD);
+    double t_exchange0 = MPI_Wtime();
+    if (engine == ENGINE_HYPERCUBE)
+    {
+        // Pairwise compare-split exchanges: every rank ends up with a sorted
+        // slice, and the slices are globally ordered by rank.
+        distributed_bitonic(local_data, local_n, rank, world_size, &pool);
+    }
+    else
+    {
+        // Fallback: all processes send their sorted data to rank 0, which
+        // merges them serially.
+        MPI_Gather(local_data, local_n, MPI_INT, all_data, local_n, MPI_INT, 0, MPI_COMM_WORLD);
+    }
 
-    if (rank == 0)
+    if (engine == ENGINE_GATHER && rank == 0)
     {
         // Merge all the sorted subarrays using temp buffer
         int *temp_buf = malloc(padded_count * sizeof(int));
@@ -345,26 +1616,165 @@ int main(int argc, char **argv)
         free(temp_buf);
     }
 
+    double exchange_s = MPI_Wtime() - t_exchange0;
+
     MPI_Barrier(MPI_COMM_WORLD);
     double end = MPI_Wtime();
+    double t_output0 = MPI_Wtime();
 
-    int *gathered = NULL;
-    if (rank == 0)
+    // Single-pass validation: every slice must be internally monotonic and
+    // ordered against its successor, and the reduced output fingerprint
+    // must match the reduced input fingerprint exactly.
+    int verify_failed = 0;
+    if (verify)
+    {
+        struct verify_sums out_sums = {0, 0, 0};
+        int sorted_ok = 1;
+        if (engine == ENGINE_HYPERCUBE)
+        {
+            out_sums = checksum_multiset(local_data, local_n);
+            sorted_ok = count_descents(local_data, local_n) == 0;
+
+            int prev = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+            int next = rank < world_size - 1 ? rank + 1 : MPI_PROC_NULL;
+            int next_first = 0;
+            MPI_Sendrecv(&local_data[0], 1, MPI_INT, prev, 5,
+                         &next_first, 1, MPI_INT, next, 5,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            if (next != MPI_PROC_NULL && local_data[local_n - 1] > next_first)
+            {
+                sorted_ok = 0;
+            }
+        }
+        else if (rank == 0)
+        {
+            out_sums = checksum_multiset(all_data, padded_count);
+            sorted_ok = count_descents(all_data, padded_count) == 0;
+        }
+
+        uint64_t add_local[4] = {in_sums.sum, in_sums.sum_sq, out_sums.sum, out_sums.sum_sq};
+        uint64_t xor_local[2] = {in_sums.xor_all, out_sums.xor_all};
+        uint64_t add_total[4];
+        uint64_t xor_total[2];
+        int sorted_all;
+        MPI_Reduce(add_local, add_total, 4, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(xor_local, xor_total, 2, MPI_UINT64_T, MPI_BXOR, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&sorted_ok, &sorted_all, 1, MPI_INT, MPI_LAND, 0, MPI_COMM_WORLD);
+
+        if (rank == 0)
+        {
+            struct verify_sums global_in = {add_total[0], xor_total[0], add_total[1]};
+            struct verify_sums global_out = {add_total[2], xor_total[1], add_total[3]};
+            int same_multiset = verify_sums_equal(global_in, global_out);
+            verify_failed = !sorted_all || !same_multiset;
+            printf("Verification: %s\n", verify_failed ? "FAIL" : "PASS");
+            if (!sorted_all)
+            {
+                fprintf(stderr, "Verification failed: output is not sorted\n");
+            }
+            if (!same_multiset)
+            {
+                fprintf(stderr, "Verification failed: output multiset differs from input\n");
+            }
+        }
+        MPI_Bcast(&verify_failed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+
+    if (parallel_output)
+    {
+        // Each rank writes its own sorted slice at its computed offset;
+        // rank 0 only contributes the 16-byte header. Trailing sentinel
+        // padding sits past original_count and is simply not written.
+        MPI_File fh;
+        if (MPI_File_open(MPI_COMM_WORLD, "OutputFiles/mpi_output.bin",
+                          MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+        {
+            if (rank == 0)
+            {
+                fprintf(stderr, "Failed to open binary output file\n");
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_File_set_size(fh, 0);
+
+        if (rank == 0)
+        {
+            struct bin_header hdr;
+            memcpy(hdr.magic, BIN_MAGIC, 4);
+            hdr.version = BIN_VERSION;
+            hdr.count = (uint64_t)original_count;
+            MPI_File_write_at(fh, 0, &hdr, sizeof(hdr), MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+
+        int start_elem = rank * local_n;
+        int avail = 0;
+        if (start_elem < original_count)
+        {
+            avail = original_count - start_elem;
+            if (avail > local_n)
+            {
+                avail = local_n;
+            }
+        }
+        MPI_Offset offset = (MPI_Offset)sizeof(struct bin_header) + (MPI_Offset)start_elem * sizeof(int);
+        MPI_File_write_at_all(fh, offset, local_data, avail, MPI_INT, MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
+    }
+    else if (engine == ENGINE_HYPERCUBE)
     {
-        gathered = all_data;
+        // The slices are already globally sorted; this gather only stages
+        // them on rank 0 for output and is not part of the timed sort.
+        MPI_Gather(local_data, local_n, MPI_INT, all_data, local_n, MPI_INT, 0, MPI_COMM_WORLD);
     }
 
     if (rank == 0)
     {
-        write_output_rank0("OutputFiles/mpi_output.txt", gathered, original_count);
+        if (parallel_output)
+        {
+            // already written collectively above
+        }
+        else if (out_format == FORMAT_BIN)
+        {
+            write_binary("OutputFiles/mpi_output.bin", all_data, original_count);
+        }
+        else
+        {
+            write_text_fast("OutputFiles/mpi_output.txt", all_data, original_count);
+        }
         printf("Processes: %d\n", world_size);
+        printf("Threads per rank: %d\n", omp_get_max_threads());
+        printf("Engine: %s\n", engine == ENGINE_HYPERCUBE ? "hypercube" : "gather");
         printf("Execution time (s): %.6f\n", end - start);
-        free(gathered);
+        // Cache population needs the full array on rank 0, which the
+        // collective binary output path deliberately avoids staging; a run
+        // that failed verification must not seed the cache either.
+        if (cache_path[0] && !parallel_output && !verify_failed)
+        {
+            if (write_binary(cache_path, all_data, original_count) == 0)
+            {
+                printf("Cache: stored\n");
+            }
+        }
+        free(all_data);
+    }
+
+    if (profile_enabled)
+    {
+        // Collective: every rank contributes its phase and per-step times.
+        double output_s = MPI_Wtime() - t_output0;
+        profile_report(rank, world_size, ingest_s, local_s, exchange_s, output_s);
     }
 
+    if (engine == ENGINE_HYPERCUBE)
+    {
+        exchange_pool_free(&pool);
+    }
     free(local_data);
-    free(global_data);
+    if (rank == 0)
+    {
+        input_buffer_release(&input);
+    }
 
     MPI_Finalize();
-    return 0;
+    return verify_failed ? 1 : 0;
 }
@@ -1,6 +1,17 @@
+#include "../common/bitonic_io.h"
+#include "../common/bitonic_kernel.h"
+#include "../common/bitonic_bench.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <omp.h>
 
 static int next_power_of_two(int n)
@@ -13,140 +24,1268 @@ static int next_power_of_two(int n)
     return p;
 }
 
-static int read_input(const char *path, int **out_data)
+// ---------------------------------------------------------------------------
+// NUMA placement: the readers fill the array single-threaded, so on
+// multi-socket machines every page lands on the reading thread's node and
+// remote accesses dominate once the sort spans sockets. --numa=firsttouch
+// re-copies the data with the same static schedule as the sort loops, so
+// each thread's pages end up on its own node; --numa=interleave spreads
+// pages round-robin instead, which is the safer choice when the access
+// pattern does not match the fill (e.g. the cross-block merge sweeps).
+// ---------------------------------------------------------------------------
+
+enum numa_mode
+{
+    NUMA_OFF,
+    NUMA_FIRST_TOUCH,
+    NUMA_INTERLEAVE
+};
+
+#define NUMA_PAGE_INTS 1024 // 4 KiB pages / sizeof(int)
+
+// Copies src into freshly faulted dst pages with NUMA-aware placement.
+// Only the first touch of a page decides its node, so later serial copies
+// into the same buffer keep the placement established here.
+static void numa_copy(int *dst, const int *src, int n, enum numa_mode mode)
 {
-    FILE *fp = fopen(path, "r");
-    if (!fp)
+    if (mode == NUMA_INTERLEAVE)
+    {
+        // One page per chunk, dealt round-robin across the team.
+        int pages = (n + NUMA_PAGE_INTS - 1) / NUMA_PAGE_INTS;
+        #pragma omp parallel for schedule(static, 1)
+        for (int p = 0; p < pages; ++p)
+        {
+            int lo = p * NUMA_PAGE_INTS;
+            int len = n - lo < NUMA_PAGE_INTS ? n - lo : NUMA_PAGE_INTS;
+            memcpy(dst + lo, src + lo, len * sizeof(int));
+        }
+    }
+    else
+    {
+        // Same contiguous static partition as the sort's parallel loops.
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            dst[i] = src[i];
+        }
+    }
+}
+
+// Replaces the buffer's single-threaded pages with NUMA-placed ones.
+static int numa_place(struct input_buffer *input, int n, enum numa_mode mode)
+{
+    int *placed = malloc(n * sizeof(int));
+    if (!placed)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    numa_copy(placed, input->data, n, mode);
+    input_buffer_release(input);
+    input->data = placed;
+    input->count = n;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Out-of-core mode: when --memory-limit caps the working set below the
+// dataset size, the input is streamed in runs that fit the cap, each run is
+// sorted in memory with the bitonic kernel and spilled to an anonymous temp
+// file, and a final k-way heap merge streams the result to the output.
+// ---------------------------------------------------------------------------
+
+#define MAX_SPILL_RUNS 1024
+
+// Sequential reader that yields up to max values per call from either a
+// text or a binary input, without mapping the whole file.
+struct stream_in
+{
+    FILE *fp;
+    int is_bin;
+    long remaining; // elements left (binary only)
+};
+
+static int stream_open(const char *path, enum input_format format, struct stream_in *s)
+{
+    if (format == FORMAT_AUTO)
+    {
+        format = detect_format(path);
+    }
+    s->is_bin = (format == FORMAT_BIN);
+    s->fp = fopen(path, s->is_bin ? "rb" : "r");
+    if (!s->fp)
     {
         perror("Failed to open input file");
         return -1;
     }
+    if (s->is_bin)
+    {
+        struct bin_header hdr;
+        if (fread(&hdr, sizeof(hdr), 1, s->fp) != 1 ||
+            memcmp(hdr.magic, BIN_MAGIC, 4) != 0 || hdr.version != BIN_VERSION)
+        {
+            fprintf(stderr, "Not a valid binary input file: %s\n", path);
+            fclose(s->fp);
+            return -1;
+        }
+        s->remaining = (long)hdr.count;
+    }
+    else
+    {
+        s->remaining = -1;
+    }
+    return 0;
+}
+
+static int stream_read(struct stream_in *s, int *buf, int max)
+{
+    if (s->is_bin)
+    {
+        long want = s->remaining < max ? s->remaining : max;
+        size_t got = want > 0 ? fread(buf, sizeof(int), (size_t)want, s->fp) : 0;
+        s->remaining -= (long)got;
+        return (int)got;
+    }
+
+    int got = 0;
+    while (got < max && fscanf(s->fp, "%d", &buf[got]) == 1)
+    {
+        ++got;
+    }
+    return got;
+}
+
+// One spilled run being consumed by the final merge.
+struct run_cursor
+{
+    FILE *fp;
+    int *buf;
+    int buf_len;
+    int buf_pos;
+    long remaining;
+};
+
+static int run_refill(struct run_cursor *run, int buf_cap)
+{
+    long want = run->remaining < buf_cap ? run->remaining : buf_cap;
+    if (want <= 0)
+    {
+        return 0;
+    }
+    run->buf_len = (int)fread(run->buf, sizeof(int), (size_t)want, run->fp);
+    run->buf_pos = 0;
+    run->remaining -= run->buf_len;
+    return run->buf_len;
+}
+
+static int external_sort(const char *input_path, enum input_format format,
+                         const char *output_path, long memory_limit)
+{
+    // Half the budget holds the run being sorted; the other half covers the
+    // merge-phase read buffers. Runs are power-of-two sized for the kernel.
+    long run_cap = memory_limit / (long)sizeof(int) / 2;
+    if (run_cap < 1024)
+    {
+        run_cap = 1024;
+    }
+    while (run_cap & (run_cap - 1))
+    {
+        run_cap &= run_cap - 1;
+    }
+
+    struct stream_in in;
+    if (stream_open(input_path, format, &in) != 0)
+    {
+        return -1;
+    }
+
+    int *run_buf = malloc((size_t)run_cap * sizeof(int));
+    if (!run_buf)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(in.fp);
+        return -1;
+    }
+
+    FILE *spill[MAX_SPILL_RUNS];
+    long spill_len[MAX_SPILL_RUNS];
+    int num_runs = 0;
+    long total = 0;
+
+    int got;
+    while ((got = stream_read(&in, run_buf, (int)run_cap)) > 0)
+    {
+        if (num_runs == MAX_SPILL_RUNS)
+        {
+            fprintf(stderr, "Too many spill runs; raise --memory-limit\n");
+            fclose(in.fp);
+            free(run_buf);
+            return -1;
+        }
+
+        int padded = next_power_of_two(got);
+        for (int i = got; i < padded; ++i)
+        {
+            run_buf[i] = INT_MAX;
+        }
+        bitonic_sort(run_buf, padded);
+
+        FILE *tmp = tmpfile();
+        if (!tmp || fwrite(run_buf, sizeof(int), (size_t)got, tmp) != (size_t)got)
+        {
+            fprintf(stderr, "Failed to spill sorted run\n");
+            fclose(in.fp);
+            free(run_buf);
+            return -1;
+        }
+        rewind(tmp);
+        spill[num_runs] = tmp;
+        spill_len[num_runs] = got;
+        ++num_runs;
+        total += got;
+    }
+    fclose(in.fp);
+    free(run_buf);
+
+    if (num_runs == 0)
+    {
+        fprintf(stderr, "No data in input file\n");
+        return -1;
+    }
+
+    // K-way merge: a small binary heap of (value, run) pairs over buffered
+    // cursors, streamed straight to the output file.
+    int buf_cap = (int)(memory_limit / (long)sizeof(int) / 2 / num_runs);
+    if (buf_cap < 1024)
+    {
+        buf_cap = 1024;
+    }
+
+    struct run_cursor *runs = malloc((size_t)num_runs * sizeof(*runs));
+    int *heap_val = malloc((size_t)num_runs * sizeof(int));
+    int *heap_run = malloc((size_t)num_runs * sizeof(int));
+    if (!runs || !heap_val || !heap_run)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    int heap_size = 0;
+    for (int r = 0; r < num_runs; ++r)
+    {
+        runs[r].fp = spill[r];
+        runs[r].buf = malloc((size_t)buf_cap * sizeof(int));
+        runs[r].buf_len = 0;
+        runs[r].buf_pos = 0;
+        runs[r].remaining = spill_len[r];
+        if (!runs[r].buf)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+        if (run_refill(&runs[r], buf_cap) > 0)
+        {
+            // sift up
+            int i = heap_size++;
+            heap_val[i] = runs[r].buf[runs[r].buf_pos++];
+            heap_run[i] = r;
+            while (i > 0 && heap_val[i] < heap_val[(i - 1) / 2])
+            {
+                int v = heap_val[i], rr = heap_run[i];
+                heap_val[i] = heap_val[(i - 1) / 2];
+                heap_run[i] = heap_run[(i - 1) / 2];
+                heap_val[(i - 1) / 2] = v;
+                heap_run[(i - 1) / 2] = rr;
+                i = (i - 1) / 2;
+            }
+        }
+    }
+
+    FILE *out = fopen(output_path, "w");
+    if (!out)
+    {
+        perror("Failed to open output file");
+        return -1;
+    }
+
+    long written = 0;
+    while (heap_size > 0)
+    {
+        int value = heap_val[0];
+        int r = heap_run[0];
+
+        fprintf(out, "%d%s", value, (written + 1 == total) ? "" : " ");
+        ++written;
+
+        if (runs[r].buf_pos == runs[r].buf_len && run_refill(&runs[r], buf_cap) == 0)
+        {
+            // Run exhausted: pop by moving the last heap entry to the root.
+            --heap_size;
+            heap_val[0] = heap_val[heap_size];
+            heap_run[0] = heap_run[heap_size];
+        }
+        else
+        {
+            heap_val[0] = runs[r].buf[runs[r].buf_pos++];
+            heap_run[0] = r;
+        }
+
+        // sift down
+        int i = 0;
+        while (1)
+        {
+            int smallest = i;
+            int l = 2 * i + 1, rr = 2 * i + 2;
+            if (l < heap_size && heap_val[l] < heap_val[smallest])
+                smallest = l;
+            if (rr < heap_size && heap_val[rr] < heap_val[smallest])
+                smallest = rr;
+            if (smallest == i)
+                break;
+            int v = heap_val[i], hr = heap_run[i];
+            heap_val[i] = heap_val[smallest];
+            heap_run[i] = heap_run[smallest];
+            heap_val[smallest] = v;
+            heap_run[smallest] = hr;
+            i = smallest;
+        }
+    }
+    fprintf(out, "\n");
+    fclose(out);
+
+    for (int r = 0; r < num_runs; ++r)
+    {
+        free(runs[r].buf);
+        fclose(runs[r].fp);
+    }
+    free(runs);
+    free(heap_val);
+    free(heap_run);
+
+    printf("Dataset size: %ld\n", total);
+    printf("Spill runs: %d\n", num_runs);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Pipelined ingest (--pipeline): a reader thread streams the file chunk by
+// chunk into a small ring of buffers while a sorter thread turns each
+// finished chunk into a sorted run, so parse time hides behind compute. The
+// runs land back to back in a grow-only array and the final pass is the
+// same log(runs) pairwise merge the adaptive path uses, starting the moment
+// the last chunk arrives.
+// ---------------------------------------------------------------------------
+
+#define PIPE_RING_SLOTS 4
+#define PIPE_CHUNK_ELEMS (1 << 20)
+
+struct pipe_slot
+{
+    int *buf;
+    int count;
+    int full;
+};
+
+// Reader/sorter handshake: one writer per field, seq_cst atomics on the
+// flag publish the count written before it and keep the concurrent
+// accesses defined. The waiting side naps instead of burning a core on IO.
+static void pipe_wait(int *flag, int until)
+{
+    for (;;)
+    {
+        int seen;
+#pragma omp atomic read seq_cst
+        seen = *flag;
+        if (seen == until)
+        {
+            break;
+        }
+        struct timespec ts = {0, 100000};
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int pipelined_sort(const char *path, enum input_format format,
+                          int **out_data, int *out_count)
+{
+    struct stream_in in;
+    if (stream_open(path, format, &in) != 0)
+    {
+        return -1;
+    }
 
-    int capacity = 1024;
-    int size = 0;
-    int *buffer = malloc(capacity * sizeof(int));
-    if (!buffer)
+    struct pipe_slot ring[PIPE_RING_SLOTS];
+    for (int s = 0; s < PIPE_RING_SLOTS; ++s)
+    {
+        ring[s].buf = malloc(PIPE_CHUNK_ELEMS * sizeof(int));
+        ring[s].count = 0;
+        ring[s].full = 0;
+        if (!ring[s].buf)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            fclose(in.fp);
+            return -1;
+        }
+    }
+
+    int *data = NULL;
+    long cap = 0;
+    int count = 0;
+    int bounds_cap = 64;
+    int *bounds = malloc(bounds_cap * sizeof(int));
+    int runs = 0;
+    int failed = 0;
+    if (!bounds)
     {
-        fclose(fp);
         fprintf(stderr, "Memory allocation failed\n");
+        fclose(in.fp);
         return -1;
     }
+    bounds[0] = 0;
 
-    while (1)
+    // The sorter's per-chunk bitonic_sort opens its own team one nesting
+    // level below the reader/sorter pair.
+    omp_set_max_active_levels(2);
+
+#pragma omp parallel num_threads(2)
     {
-        int value;
-        int scanned = fscanf(fp, "%d", &value);
-        if (scanned == 1)
+        if (omp_get_thread_num() == 0)
         {
-            if (size == capacity)
+            // Reader: fill slots in ring order; a zero-length chunk is the
+            // end-of-input sentinel the sorter stops on.
+            for (int slot = 0;; slot = (slot + 1) % PIPE_RING_SLOTS)
             {
-                capacity *= 2;
-                int *tmp = realloc(buffer, capacity * sizeof(int));
-                if (!tmp)
+                pipe_wait(&ring[slot].full, 0);
+                int got = stream_read(&in, ring[slot].buf, PIPE_CHUNK_ELEMS);
+                ring[slot].count = got;
+#pragma omp atomic write seq_cst
+                ring[slot].full = 1;
+                if (got == 0)
                 {
-                    free(buffer);
-                    fclose(fp);
-                    fprintf(stderr, "Memory allocation failed\n");
-                    return -1;
+                    break;
                 }
-                buffer = tmp;
             }
-            buffer[size++] = value;
         }
-        else if (scanned == EOF)
+        else
         {
-            break;
+            // Sorter: sort each chunk while the reader parses the next one,
+            // then append the run and hand the slot back.
+            for (int slot = 0;; slot = (slot + 1) % PIPE_RING_SLOTS)
+            {
+                pipe_wait(&ring[slot].full, 1);
+                int got = ring[slot].count;
+                if (got > 0 && !failed)
+                {
+                    bitonic_sort(ring[slot].buf, got);
+                    if ((long)count + got > cap)
+                    {
+                        long grown = cap ? cap * 2 : PIPE_CHUNK_ELEMS;
+                        while (grown < (long)count + got)
+                        {
+                            grown *= 2;
+                        }
+                        int *moved = realloc(data, grown * sizeof(int));
+                        if (!moved)
+                        {
+                            failed = 1;
+                        }
+                        else
+                        {
+                            data = moved;
+                            cap = grown;
+                        }
+                    }
+                    if (!failed)
+                    {
+                        if (runs + 2 > bounds_cap)
+                        {
+                            bounds_cap *= 2;
+                            int *b = realloc(bounds, bounds_cap * sizeof(int));
+                            if (!b)
+                            {
+                                failed = 1;
+                            }
+                            else
+                            {
+                                bounds = b;
+                            }
+                        }
+                    }
+                    if (!failed)
+                    {
+                        memcpy(data + count, ring[slot].buf, got * sizeof(int));
+                        count += got;
+                        bounds[++runs] = count;
+                    }
+                }
+#pragma omp atomic write seq_cst
+                ring[slot].full = 0;
+                if (got == 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    fclose(in.fp);
+    for (int s = 0; s < PIPE_RING_SLOTS; ++s)
+    {
+        free(ring[s].buf);
+    }
+
+    if (failed || count == 0)
+    {
+        if (failed)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
         }
         else
         {
-            free(buffer);
-            fclose(fp);
-            fprintf(stderr, "Invalid data in input file\n");
-            return -1;
+            fprintf(stderr, "No integers found in %s\n", path);
         }
+        free(data);
+        free(bounds);
+        return -1;
     }
 
-    fclose(fp);
-    *out_data = buffer;
-    return size;
+    merge_runs(data, count, bounds, runs);
+    free(bounds);
+    *out_data = data;
+    *out_count = count;
+    return 0;
 }
 
-static void write_output(const char *path, const int *data, int count)
+// Parse sizes like 1073741824, 512M, 2G.
+static long parse_size(const char *text)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp)
+    char *end = NULL;
+    long value = strtol(text, &end, 10);
+    if (value <= 0)
     {
-        perror("Failed to open output file");
+        return -1;
+    }
+    if (*end == 'K' || *end == 'k')
+        value <<= 10;
+    else if (*end == 'M' || *end == 'm')
+        value <<= 20;
+    else if (*end == 'G' || *end == 'g')
+        value <<= 30;
+    else if (*end != '\0')
+        return -1;
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// Server mode: a long-running daemon that takes sort jobs over a Unix
+// socket, so repeated small jobs stop paying process startup, thread pool
+// creation and cold page faults. The work buffer is grow-only and reused
+// across jobs, and a connection can queue many newline-delimited jobs
+// back to back, which is where the batching win comes from.
+//
+// Protocol, one line per job:  sort <input_path> <output_path>
+// Reply:                       ok <count> <sort_seconds>   or   err <reason>
+// A "quit" line shuts the daemon down.
+// ---------------------------------------------------------------------------
+
+// Grow-only job buffer: pages faulted by earlier jobs stay warm for later
+// ones, which is most of the per-job latency on small files.
+static int serve_reserve(int **buf, int *cap, int need)
+{
+    if (need <= *cap)
+    {
+        return 0;
+    }
+    int *grown = realloc(*buf, need * sizeof(int));
+    if (!grown)
+    {
+        return -1;
+    }
+    *buf = grown;
+    *cap = need;
+    return 0;
+}
+
+static void serve_job(FILE *io, const char *in_path, const char *out_path,
+                      int **warm, int *warm_cap)
+{
+    struct input_buffer input;
+    int count = read_input(in_path, FORMAT_AUTO, &input);
+    if (count <= 0)
+    {
+        fprintf(io, "err cannot read %s\n", in_path);
         return;
     }
 
-    for (int i = 0; i < count; ++i)
+    int padded = next_power_of_two(count);
+    if (serve_reserve(warm, warm_cap, padded) != 0)
     {
-        fprintf(fp, "%d%s", data[i], (i + 1 == count) ? "" : " ");
+        fprintf(io, "err out of memory\n");
+        input_buffer_release(&input);
+        return;
     }
-    fprintf(fp, "\n");
-    fclose(fp);
+    memcpy(*warm, input.data, count * sizeof(int));
+    for (int i = count; i < padded; ++i)
+    {
+        (*warm)[i] = INT_MAX;
+    }
+    input_buffer_release(&input);
+
+    double t0 = omp_get_wtime();
+    bitonic_sort(*warm, padded);
+    double secs = omp_get_wtime() - t0;
+
+    int rc = detect_format(out_path) == FORMAT_BIN
+                 ? write_binary(out_path, *warm, count)
+                 : write_text_fast(out_path, *warm, count);
+    if (rc != 0)
+    {
+        fprintf(io, "err cannot write %s\n", out_path);
+        return;
+    }
+    fprintf(io, "ok %d %.6f\n", count, secs);
 }
 
-static void bitonic_sort(int *data, int n)
+static int run_server(const char *sock_path)
 {
-    for (int k = 2; k <= n; k <<= 1)
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("Failed to create socket");
+        return 1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(sock_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", sock_path);
+        close(fd);
+        return 1;
+    }
+    strcpy(addr.sun_path, sock_path);
+    unlink(sock_path); // stale socket from a previous run
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0)
+    {
+        perror("Failed to bind socket");
+        close(fd);
+        return 1;
+    }
+
+    // Spin the thread pool up once so the first job does not pay for it.
+#pragma omp parallel
+    {
+    }
+
+    int *warm = NULL;
+    int warm_cap = 0;
+    int running = 1;
+    printf("Serving sort jobs on %s with %d threads\n", sock_path, omp_get_max_threads());
+
+    while (running)
     {
-        for (int j = k >> 1; j > 0; j >>= 1)
+        int conn = accept(fd, NULL, NULL);
+        if (conn < 0)
         {
-#pragma omp parallel for schedule(static)
-            for (int i = 0; i < n; ++i)
+            if (errno == EINTR)
             {
-                int ixj = i ^ j;
-                if (ixj > i)
-                {
-                    int ascending = ((i & k) == 0);
-                    if ((data[i] > data[ixj]) == ascending)
-                    {
-                        int tmp = data[i];
-                        data[i] = data[ixj];
-                        data[ixj] = tmp;
-                    }
-                }
+                continue;
+            }
+            perror("accept failed");
+            break;
+        }
+
+        FILE *io = fdopen(conn, "r+");
+        if (!io)
+        {
+            close(conn);
+            continue;
+        }
+
+        char line[4096];
+        while (fgets(line, sizeof(line), io))
+        {
+            char in_path[1924];
+            char out_path[1924];
+            if (strncmp(line, "quit", 4) == 0)
+            {
+                fprintf(io, "ok bye\n");
+                running = 0;
+                break;
             }
+            if (sscanf(line, "sort %1923s %1923s", in_path, out_path) == 2)
+            {
+                serve_job(io, in_path, out_path, &warm, &warm_cap);
+            }
+            else
+            {
+                fprintf(io, "err unknown command\n");
+            }
+            fflush(io);
         }
+        fclose(io);
     }
+
+    free(warm);
+    close(fd);
+    unlink(sock_path);
+    return 0;
 }
 
+// ---------------------------------------------------------------------------
+// Typed drivers (--type=): one read/pad/sort/write pipeline per element
+// type, generated against the specialized kernels so no dispatch or
+// function-pointer comparator sits on the hot path. The int32 default goes
+// through the original path untouched.
+// ---------------------------------------------------------------------------
+
+enum value_type
+{
+    TYPE_INT32,
+    TYPE_INT64,
+    TYPE_UINT32,
+    TYPE_FLOAT32,
+    TYPE_FLOAT64
+};
+
+#define DEFINE_TYPED_DRIVER(NAME, T, SENTINEL)                                 \
+    static int run_typed_##NAME(const char *input_path,                        \
+                                enum input_format format,                      \
+                                enum input_format out_format)                  \
+    {                                                                          \
+        struct NAME##_buffer buf;                                              \
+        int count = read_##NAME(input_path, format, &buf);                     \
+        if (count <= 0)                                                        \
+        {                                                                      \
+            return 1;                                                          \
+        }                                                                      \
+        int padded = next_power_of_two(count);                                 \
+        if (NAME##_buffer_pad(&buf, padded, SENTINEL) != 0)                    \
+        {                                                                      \
+            free(buf.data);                                                    \
+            return 1;                                                          \
+        }                                                                      \
+                                                                               \
+        double start = omp_get_wtime();                                        \
+        bitonic_sort_##NAME(buf.data, padded);                                 \
+        double end = omp_get_wtime();                                          \
+                                                                               \
+        printf("Dataset size: %d\n", count);                                   \
+        printf("Threads: %d\n", omp_get_max_threads());                        \
+        printf("Execution time (s): %.6f\n", end - start);                     \
+                                                                               \
+        int rc = out_format == FORMAT_BIN                                      \
+                     ? write_##NAME##_binary("OutputFiles/openmp_output.bin",  \
+                                             buf.data, count)                  \
+                     : write_##NAME##_text("OutputFiles/openmp_output.txt",    \
+                                           buf.data, count);                   \
+        free(buf.data);                                                        \
+        return rc == 0 ? 0 : 1;                                                \
+    }
+
+DEFINE_TYPED_DRIVER(i64, int64_t, INT64_MAX)
+DEFINE_TYPED_DRIVER(u32, uint32_t, UINT32_MAX)
+DEFINE_TYPED_DRIVER(f32, float, INFINITY)
+DEFINE_TYPED_DRIVER(f64, double, INFINITY)
+
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    const char *input_path = NULL;
+    const char *convert_path = NULL;
+    const char *serve_path = NULL;
+    const char *cache_dir = NULL;
+    enum input_format format = FORMAT_AUTO;
+    long memory_limit = 0;
+    int no_pad = 0;
+    int records_mode = 0;
+    int bench_reps = 0;
+    int profile = 0;
+    int adaptive = 0;
+    int top_k = 0;
+    int use_gpu = 0;
+    int pipeline = 0;
+    int verify = 0;
+    enum value_type vtype = TYPE_INT32;
+    enum numa_mode numa = NUMA_OFF;
+    enum input_format out_format = FORMAT_TXT;
+
+    for (int arg = 1; arg < argc; ++arg)
     {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+        if (strcmp(argv[arg], "--format=bin") == 0)
+        {
+            format = FORMAT_BIN;
+        }
+        else if (strcmp(argv[arg], "--format=txt") == 0)
+        {
+            format = FORMAT_TXT;
+        }
+        else if (strncmp(argv[arg], "--convert=", 10) == 0)
+        {
+            convert_path = argv[arg] + 10;
+        }
+        else if (strcmp(argv[arg], "--output-format=bin") == 0)
+        {
+            out_format = FORMAT_BIN;
+        }
+        else if (strcmp(argv[arg], "--output-format=txt") == 0)
+        {
+            out_format = FORMAT_TXT;
+        }
+        else if (strcmp(argv[arg], "--no-pad") == 0)
+        {
+            no_pad = 1;
+        }
+        else if (strcmp(argv[arg], "--records") == 0)
+        {
+            records_mode = 1;
+        }
+        else if (strncmp(argv[arg], "--bench=", 8) == 0)
+        {
+            bench_reps = atoi(argv[arg] + 8);
+            if (bench_reps <= 0)
+            {
+                fprintf(stderr, "Invalid repetition count: %s\n", argv[arg] + 8);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg], "--profile") == 0)
+        {
+            profile = 1;
+        }
+        else if (strcmp(argv[arg], "--numa=firsttouch") == 0)
+        {
+            numa = NUMA_FIRST_TOUCH;
+        }
+        else if (strcmp(argv[arg], "--numa=interleave") == 0)
+        {
+            numa = NUMA_INTERLEAVE;
+        }
+        else if (strcmp(argv[arg], "--numa=off") == 0)
+        {
+            numa = NUMA_OFF;
+        }
+        else if (strcmp(argv[arg], "--adaptive") == 0)
+        {
+            adaptive = 1;
+        }
+        else if (strncmp(argv[arg], "--serve=", 8) == 0)
+        {
+            serve_path = argv[arg] + 8;
+        }
+        else if (strncmp(argv[arg], "--cache=", 8) == 0)
+        {
+            cache_dir = argv[arg] + 8;
+        }
+        else if (strcmp(argv[arg], "--engine=gpu") == 0)
+        {
+            use_gpu = 1;
+        }
+        else if (strcmp(argv[arg], "--engine=cpu") == 0)
+        {
+            use_gpu = 0;
+        }
+        else if (strcmp(argv[arg], "--pipeline") == 0)
+        {
+            pipeline = 1;
+        }
+        else if (strcmp(argv[arg], "--verify") == 0)
+        {
+            verify = 1;
+        }
+        else if (strcmp(argv[arg], "--type=int32") == 0)
+        {
+            vtype = TYPE_INT32;
+        }
+        else if (strcmp(argv[arg], "--type=int64") == 0)
+        {
+            vtype = TYPE_INT64;
+        }
+        else if (strcmp(argv[arg], "--type=uint32") == 0)
+        {
+            vtype = TYPE_UINT32;
+        }
+        else if (strcmp(argv[arg], "--type=float32") == 0)
+        {
+            vtype = TYPE_FLOAT32;
+        }
+        else if (strcmp(argv[arg], "--type=float64") == 0)
+        {
+            vtype = TYPE_FLOAT64;
+        }
+        else if (strncmp(argv[arg], "--top-k=", 8) == 0)
+        {
+            top_k = atoi(argv[arg] + 8);
+            if (top_k <= 0)
+            {
+                fprintf(stderr, "Invalid top-k count: %s\n", argv[arg] + 8);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[arg], "--memory-limit=", 15) == 0)
+        {
+            memory_limit = parse_size(argv[arg] + 15);
+            if (memory_limit <= 0)
+            {
+                fprintf(stderr, "Invalid memory limit: %s\n", argv[arg] + 15);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[arg], "--", 2) == 0)
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[arg]);
+            return 1;
+        }
+        else
+        {
+            input_path = argv[arg];
+        }
+    }
+
+    if (serve_path)
+    {
+        return run_server(serve_path);
+    }
+
+    if (!input_path)
+    {
+        fprintf(stderr, "Usage: %s [--format=txt|bin] [--convert=out.bin] [--memory-limit=N[KMG]] [--no-pad] [--numa=firsttouch|interleave|off] [--serve=socket] <input_file>\n", argv[0]);
         return 1;
     }
 
-    int *values = NULL;
-    int count = read_input(argv[1], &values);
+    // Pin threads when NUMA placement is requested; without affinity the
+    // scheduler can migrate threads across sockets and undo the first-touch
+    // layout mid-sort. Must happen before the first parallel region, and an
+    // explicit OMP_PROC_BIND/OMP_PLACES in the environment wins.
+    if (numa != NUMA_OFF)
+    {
+        setenv("OMP_PROC_BIND", "spread", 0);
+        setenv("OMP_PLACES", "cores", 0);
+    }
+
+    // Typed modes run their own generated pipeline; int32 stays on the
+    // original path below with all its flags.
+    switch (vtype)
+    {
+    case TYPE_INT64:
+        return run_typed_i64(input_path, format, out_format);
+    case TYPE_UINT32:
+        return run_typed_u32(input_path, format, out_format);
+    case TYPE_FLOAT32:
+        return run_typed_f32(input_path, format, out_format);
+    case TYPE_FLOAT64:
+        return run_typed_f64(input_path, format, out_format);
+    case TYPE_INT32:
+        break;
+    }
+
+    // Key-payload mode: 64-bit keys carrying a 64-bit payload, sorted by
+    // key with the payload moved in the same passes.
+    if (records_mode)
+    {
+        struct kv_buffer kv;
+        int count = read_records(input_path, format, &kv);
+        if (count <= 0)
+        {
+            return 1;
+        }
+
+        if (convert_path)
+        {
+            int rc = write_records_binary(convert_path, kv.data, count);
+            if (rc == 0)
+            {
+                printf("Converted %d records to %s\n", count, convert_path);
+            }
+            kv_buffer_release(&kv);
+            return rc == 0 ? 0 : 1;
+        }
+
+        int padded = next_power_of_two(count);
+        if (kv_buffer_pad(&kv, padded) != 0)
+        {
+            kv_buffer_release(&kv);
+            return 1;
+        }
+
+        double start = omp_get_wtime();
+        bitonic_sort_kv(kv.data, padded);
+        double end = omp_get_wtime();
+
+        printf("Dataset size: %d\n", count);
+        printf("Threads: %d\n", omp_get_max_threads());
+        printf("Execution time (s): %.6f\n", end - start);
+
+        if (out_format == FORMAT_BIN)
+        {
+            write_records_binary("OutputFiles/openmp_output.bin", kv.data, count);
+        }
+        else
+        {
+            write_records_text("OutputFiles/openmp_output.txt", kv.data, count);
+        }
+
+        kv_buffer_release(&kv);
+        return 0;
+    }
+
+    if (memory_limit > 0)
+    {
+        double start = omp_get_wtime();
+        int rc = external_sort(input_path, format, "OutputFiles/openmp_output.txt", memory_limit);
+        double end = omp_get_wtime();
+        if (rc != 0)
+        {
+            return 1;
+        }
+        printf("Threads: %d\n", omp_get_max_threads());
+        printf("Execution time (s): %.6f\n", end - start);
+        return 0;
+    }
+
+    // Pipelined mode folds read and sort into one overlapped phase, so the
+    // reported time covers both; that is the quantity it optimizes.
+    if (pipeline)
+    {
+        int *data = NULL;
+        int count = 0;
+        double start = omp_get_wtime();
+        if (pipelined_sort(input_path, format, &data, &count) != 0)
+        {
+            return 1;
+        }
+        double end = omp_get_wtime();
+
+        printf("Dataset size: %d\n", count);
+        printf("Threads: %d\n", omp_get_max_threads());
+        printf("Execution time (s): %.6f\n", end - start);
+
+        if (out_format == FORMAT_BIN)
+        {
+            write_binary("OutputFiles/openmp_output.bin", data, count);
+        }
+        else
+        {
+            write_text_fast("OutputFiles/openmp_output.txt", data, count);
+        }
+        free(data);
+        return 0;
+    }
+
+    // Opt-in result cache: an entry keyed by the input's identity and
+    // content short-circuits parsing and sorting entirely; population
+    // rides on the normal output write below. Only the plain full-sort
+    // path may consult it — converter, top-k and bench runs want their
+    // own work done, not a replayed artifact.
+    char cache_path[4096];
+    cache_path[0] = '\0';
+    if (cache_dir && !convert_path && top_k == 0 && bench_reps == 0)
+    {
+        char key[17];
+        if (compute_cache_key(input_path, key, sizeof(key)) == 0)
+        {
+            snprintf(cache_path, sizeof(cache_path), "%s/bitonic-%s.bin", cache_dir, key);
+            if (access(cache_path, R_OK) == 0)
+            {
+                double start = omp_get_wtime();
+                struct input_buffer cached;
+                int cached_count = read_input(cache_path, FORMAT_BIN, &cached);
+                if (cached_count > 0)
+                {
+                    if (out_format == FORMAT_BIN)
+                    {
+                        write_binary("OutputFiles/openmp_output.bin", cached.data, cached_count);
+                    }
+                    else
+                    {
+                        write_text_fast("OutputFiles/openmp_output.txt", cached.data, cached_count);
+                    }
+                    double end = omp_get_wtime();
+                    printf("Dataset size: %d\n", cached_count);
+                    printf("Threads: %d\n", omp_get_max_threads());
+                    printf("Execution time (s): %.6f\n", end - start);
+                    printf("Cache: hit\n");
+                    input_buffer_release(&cached);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    double t_read0 = omp_get_wtime();
+    struct input_buffer input;
+    int count = read_input(input_path, format, &input);
     if (count <= 0)
     {
         return 1;
     }
+    double t_read = omp_get_wtime() - t_read0;
 
-    int padded = next_power_of_two(count);
-    if (padded != count)
+    // Fingerprint the input before padding can add sentinels; the matching
+    // pass after the sort must reproduce it exactly.
+    struct verify_sums in_sums = {0, 0, 0};
+    if (verify)
     {
-        int *tmp = realloc(values, padded * sizeof(int));
-        if (!tmp)
+        in_sums = checksum_multiset(input.data, count);
+    }
+
+    // Converter mode: write the loaded data back out in the binary
+    // container format and exit without sorting.
+    if (convert_path)
+    {
+        int rc = write_binary(convert_path, input.data, count);
+        if (rc == 0)
+        {
+            printf("Converted %d values to %s\n", count, convert_path);
+        }
+        input_buffer_release(&input);
+        return rc == 0 ? 0 : 1;
+    }
+
+    // Partial sort: select the K smallest with per-thread bounded heaps and
+    // write only those, skipping padding, the full schedule and nearly all
+    // output cost.
+    if (top_k > 0)
+    {
+        int k = top_k < count ? top_k : count;
+        int *smallest = malloc(k * sizeof(int));
+        if (!smallest)
         {
-            free(values);
             fprintf(stderr, "Memory allocation failed\n");
+            input_buffer_release(&input);
             return 1;
         }
-        values = tmp;
-        for (int i = count; i < padded; ++i)
+
+        double start = omp_get_wtime();
+        int have = topk_select(input.data, count, k, smallest);
+        double end = omp_get_wtime();
+
+        printf("Dataset size: %d\n", count);
+        printf("Threads: %d\n", omp_get_max_threads());
+        printf("Top-K: %d\n", have);
+        printf("Execution time (s): %.6f\n", end - start);
+
+        if (out_format == FORMAT_BIN)
+        {
+            write_binary("OutputFiles/openmp_output.bin", smallest, have);
+        }
+        else
         {
-            values[i] = INT_MAX; // sentinel to keep padding at the end
+            write_text_fast("OutputFiles/openmp_output.txt", smallest, have);
         }
+
+        free(smallest);
+        input_buffer_release(&input);
+        return 0;
     }
 
+    // Padding-free mode: sort the real element count with the arbitrary-n
+    // network instead of growing the array to the next power of two. For
+    // inputs just past a power of two this halves footprint and work.
+    // The GPU schedule is the plain power-of-two network, so it overrides
+    // --no-pad; without an offload device it falls back to the CPU engine,
+    // which beats host-executed target regions.
+    if (use_gpu && !gpu_available())
+    {
+        fprintf(stderr, "No offload device available, using CPU engine\n");
+        use_gpu = 0;
+    }
+
+    double t_pad0 = omp_get_wtime();
+    int padded = (no_pad && !use_gpu) ? count : next_power_of_two(count);
+    if (input_buffer_pad(&input, padded) != 0)
+    {
+        input_buffer_release(&input);
+        return 1;
+    }
+    if (numa != NUMA_OFF && numa_place(&input, padded, numa) != 0)
+    {
+        input_buffer_release(&input);
+        return 1;
+    }
+    int *values = input.data;
+    double t_pad = omp_get_wtime() - t_pad0;
+
+    if (profile)
+    {
+        kernel_profile_enabled = 1;
+        kernel_profile_reset();
+    }
+
+    // Benchmark mode: pre-touched work buffer, one warmup, then N timed
+    // repetitions on reshuffled copies, with stats in a machine-readable
+    // CSV row. No output file is written.
+    if (bench_reps > 0)
+    {
+        int *work = malloc(padded * sizeof(int));
+        double *times = malloc(bench_reps * sizeof(double));
+        if (!work || !times)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return 1;
+        }
+
+        // Warmup run: faults the work buffer pages in and warms the caches
+        // and thread pool before anything is measured. With a NUMA mode
+        // active the first touch also fixes the pages' node placement for
+        // every timed repetition that follows.
+        if (numa != NUMA_OFF)
+        {
+            numa_copy(work, values, padded, numa);
+        }
+        else
+        {
+            memcpy(work, values, padded * sizeof(int));
+        }
+        bitonic_sort(work, padded);
+
+        for (int rep = 0; rep < bench_reps; ++rep)
+        {
+            memcpy(work, values, padded * sizeof(int));
+            shuffle_ints(work, count, (unsigned)(rep + 1));
+
+            double start = omp_get_wtime();
+            bitonic_sort(work, padded);
+            double end = omp_get_wtime();
+            times[rep] = end - start;
+        }
+
+        struct bench_stats stats = bench_compute(times, bench_reps);
+        double melems = (double)count / stats.median / 1e6;
+
+        printf("bench_csv,impl,threads,n,reps,min_s,median_s,mean_s,stddev_s,melems_per_s\n");
+        printf("bench_csv,openmp,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.2f\n",
+               omp_get_max_threads(), count, bench_reps,
+               stats.min, stats.median, stats.mean, stats.stddev, melems);
+
+        free(work);
+        free(times);
+        input_buffer_release(&input);
+        return 0;
+    }
+
+    // Adaptive mode skips or shortens the oblivious schedule when the
+    // input is already (mostly) run-sorted, e.g. yesterday's output plus a
+    // few appended records.
     double start = omp_get_wtime();
-    bitonic_sort(values, padded);
+    if (use_gpu)
+    {
+        bitonic_sort_gpu(values, padded);
+    }
+    else if (counting_sort_try(values, padded))
+    {
+        // Low-cardinality input handled in one O(n) histogram pass; the
+        // sampling pre-pass rejected anything this could get wrong.
+    }
+    else if (adaptive)
+    {
+        bitonic_sort_adaptive(values, padded);
+    }
+    else
+    {
+        bitonic_sort(values, padded);
+    }
     double end = omp_get_wtime();
 
     int threads_used = omp_get_max_threads();
@@ -154,8 +1293,60 @@ int main(int argc, char **argv)
     printf("Threads: %d\n", threads_used);
     printf("Execution time (s): %.6f\n", end - start);
 
-    write_output("OutputFiles/openmp_output.txt", values, count);
+    // Single-pass validation: the first count elements must be monotonic
+    // and carry exactly the input's multiset. Sentinel padding sits past
+    // count, so a truncated or sentinel-polluted result fails here.
+    int verify_failed = 0;
+    if (verify)
+    {
+        struct verify_sums out_sums = checksum_multiset(values, count);
+        int monotonic = count_descents(values, count) == 0;
+        int same_multiset = verify_sums_equal(in_sums, out_sums);
+        verify_failed = !monotonic || !same_multiset;
+        printf("Verification: %s\n", verify_failed ? "FAIL" : "PASS");
+        if (!monotonic)
+        {
+            fprintf(stderr, "Verification failed: output is not sorted\n");
+        }
+        if (!same_multiset)
+        {
+            fprintf(stderr, "Verification failed: output multiset differs from input\n");
+        }
+    }
+
+    // Binary output matches the input container format, so sort pipelines
+    // can chain runs without re-parsing text.
+    double t_write0 = omp_get_wtime();
+    if (out_format == FORMAT_BIN)
+    {
+        write_binary("OutputFiles/openmp_output.bin", values, count);
+    }
+    else
+    {
+        write_text_fast("OutputFiles/openmp_output.txt", values, count);
+    }
+    double t_write = omp_get_wtime() - t_write0;
 
-    free(values);
-    return 0;
+    // Cache population: the sorted data is in hand, so storing it is one
+    // more sequential write.
+    if (cache_path[0] && !verify_failed)
+    {
+        if (write_binary(cache_path, values, count) == 0)
+        {
+            printf("Cache: stored\n");
+        }
+    }
+
+    if (profile)
+    {
+        printf("profile_csv,phase,name,seconds\n");
+        printf("profile_csv,phase,read,%.6f\n", t_read);
+        printf("profile_csv,phase,pad,%.6f\n", t_pad);
+        printf("profile_csv,phase,sort,%.6f\n", end - start);
+        printf("profile_csv,phase,write,%.6f\n", t_write);
+        kernel_profile_report();
+    }
+
+    input_buffer_release(&input);
+    return verify_failed ? 1 : 0;
 }
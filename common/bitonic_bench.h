@@ -0,0 +1,66 @@
+#ifndef BITONIC_BENCH_H
+#define BITONIC_BENCH_H
+
+// Helpers for the --bench mode of both binaries: deterministic reshuffling
+// between repetitions and summary statistics over the collected times.
+
+#include <math.h>
+#include <stdlib.h>
+
+struct bench_stats
+{
+    double min;
+    double median;
+    double mean;
+    double stddev;
+};
+
+static int double_compare(const void *a, const void *b)
+{
+    double lhs = *(const double *)a;
+    double rhs = *(const double *)b;
+    if (lhs < rhs)
+        return -1;
+    if (lhs > rhs)
+        return 1;
+    return 0;
+}
+
+static struct bench_stats bench_compute(double *times, int n)
+{
+    struct bench_stats s = {0};
+    qsort(times, n, sizeof(double), double_compare);
+    s.min = times[0];
+    s.median = (n % 2) ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        sum += times[i];
+    }
+    s.mean = sum / n;
+
+    double var = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        double d = times[i] - s.mean;
+        var += d * d;
+    }
+    s.stddev = n > 1 ? sqrt(var / (n - 1)) : 0.0;
+    return s;
+}
+
+// Deterministic Fisher-Yates shuffle so every repetition sorts a fresh,
+// reproducible permutation instead of the previous run's sorted output.
+static void shuffle_ints(int *data, int n, unsigned seed)
+{
+    for (int i = n - 1; i > 0; --i)
+    {
+        int j = (int)(rand_r(&seed) % (unsigned)(i + 1));
+        int tmp = data[i];
+        data[i] = data[j];
+        data[j] = tmp;
+    }
+}
+
+#endif // BITONIC_BENCH_H
@@ -0,0 +1,823 @@
+#ifndef BITONIC_IO_H
+#define BITONIC_IO_H
+
+// Shared input/output helpers for the OpenMP and MPI bitonic sort binaries.
+//
+// Two on-disk formats are supported:
+//   - text: whitespace-separated decimal integers (the original format)
+//   - bin:  a small container with a magic header, element count, and a raw
+//           little-endian int32 payload, loaded zero-copy via mmap
+//
+// The binary payload starts at a fixed 16-byte offset so it stays aligned
+// for int32 access. Values are stored in host byte order; both supported
+// platforms (x86-64, Apple/ARM64) are little-endian.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BIN_MAGIC "BSRT"
+#define BIN_VERSION 1u
+
+struct bin_header
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+};
+
+enum input_format
+{
+    FORMAT_AUTO,
+    FORMAT_TXT,
+    FORMAT_BIN
+};
+
+// Holds loaded input data. For text input `data` is heap-allocated and
+// `map_base` is NULL; for binary input `data` points into a private
+// (copy-on-write) mapping described by `map_base`/`map_len`.
+struct input_buffer
+{
+    int *data;
+    int count;
+    void *map_base;
+    size_t map_len;
+};
+
+static enum input_format detect_format(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot && strcmp(dot, ".bin") == 0)
+    {
+        return FORMAT_BIN;
+    }
+    return FORMAT_TXT;
+}
+
+static int read_input_text(const char *path, struct input_buffer *in)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        perror("Failed to open input file");
+        return -1;
+    }
+
+    int capacity = 1024;
+    int size = 0;
+    int *buffer = malloc(capacity * sizeof(int));
+    if (!buffer)
+    {
+        fclose(fp);
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    while (1)
+    {
+        int value;
+        int scanned = fscanf(fp, "%d", &value);
+        if (scanned == 1)
+        {
+            if (size == capacity)
+            {
+                capacity *= 2;
+                int *tmp = realloc(buffer, capacity * sizeof(int));
+                if (!tmp)
+                {
+                    free(buffer);
+                    fclose(fp);
+                    fprintf(stderr, "Memory allocation failed\n");
+                    return -1;
+                }
+                buffer = tmp;
+            }
+            buffer[size++] = value;
+        }
+        else if (scanned == EOF)
+        {
+            break;
+        }
+        else
+        {
+            free(buffer);
+            fclose(fp);
+            fprintf(stderr, "Invalid data in input file\n");
+            return -1;
+        }
+    }
+
+    fclose(fp);
+    in->data = buffer;
+    in->count = size;
+    in->map_base = NULL;
+    in->map_len = 0;
+    return size;
+}
+
+static int read_input_binary(const char *path, struct input_buffer *in)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Failed to open input file");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        perror("fstat failed on input file");
+        close(fd);
+        return -1;
+    }
+
+    if ((size_t)st.st_size < sizeof(struct bin_header))
+    {
+        fprintf(stderr, "Binary input too small for header: %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    // MAP_PRIVATE gives copy-on-write pages, so the sort can run in place
+    // on the mapping without touching the file.
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap failed on input file");
+        return -1;
+    }
+
+    struct bin_header *hdr = base;
+    if (memcmp(hdr->magic, BIN_MAGIC, 4) != 0 || hdr->version != BIN_VERSION)
+    {
+        fprintf(stderr, "Not a valid binary input file: %s\n", path);
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    if (hdr->count > INT_MAX || sizeof(struct bin_header) + hdr->count * sizeof(int) > (size_t)st.st_size)
+    {
+        fprintf(stderr, "Binary input header count does not match file size: %s\n", path);
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    in->data = (int *)((char *)base + sizeof(struct bin_header));
+    in->count = (int)hdr->count;
+    in->map_base = base;
+    in->map_len = (size_t)st.st_size;
+    return in->count;
+}
+
+static int read_input(const char *path, enum input_format format, struct input_buffer *in)
+{
+    if (format == FORMAT_AUTO)
+    {
+        format = detect_format(path);
+    }
+    if (format == FORMAT_BIN)
+    {
+        return read_input_binary(path, in);
+    }
+    return read_input_text(path, in);
+}
+
+// Grow the buffer to padded_count elements, filling the tail with INT_MAX
+// sentinels. Mapped input is copied into a heap buffer first since a
+// mapping cannot be resized with realloc.
+static int input_buffer_pad(struct input_buffer *in, int padded_count)
+{
+    if (padded_count <= in->count)
+    {
+        return 0;
+    }
+
+    if (in->map_base)
+    {
+        int *copy = malloc(padded_count * sizeof(int));
+        if (!copy)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+        memcpy(copy, in->data, in->count * sizeof(int));
+        munmap(in->map_base, in->map_len);
+        in->data = copy;
+        in->map_base = NULL;
+        in->map_len = 0;
+    }
+    else
+    {
+        int *tmp = realloc(in->data, padded_count * sizeof(int));
+        if (!tmp)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+        in->data = tmp;
+    }
+
+    for (int i = in->count; i < padded_count; ++i)
+    {
+        in->data[i] = INT_MAX; // sentinel to keep padding at the end
+    }
+    return 0;
+}
+
+static void input_buffer_release(struct input_buffer *in)
+{
+    if (in->map_base)
+    {
+        munmap(in->map_base, in->map_len);
+    }
+    else
+    {
+        free(in->data);
+    }
+    in->data = NULL;
+    in->count = 0;
+    in->map_base = NULL;
+    in->map_len = 0;
+}
+
+// Text writer with a large user-space buffer and a hand-rolled integer
+// formatter; one fprintf per element was printf-bound at large counts.
+static int write_text_fast(const char *path, const int *data, int count)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+    {
+        perror("Failed to open output file");
+        return -1;
+    }
+
+    size_t cap = 1 << 20;
+    char *buf = malloc(cap);
+    if (!buf)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(fp);
+        return -1;
+    }
+
+    size_t len = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        // Worst case: sign + 10 digits + separator.
+        if (len + 12 > cap)
+        {
+            fwrite(buf, 1, len, fp);
+            len = 0;
+        }
+
+        int v = data[i];
+        unsigned u;
+        if (v < 0)
+        {
+            buf[len++] = '-';
+            u = (unsigned)(-(long)v);
+        }
+        else
+        {
+            u = (unsigned)v;
+        }
+
+        char digits[10];
+        int nd = 0;
+        do
+        {
+            digits[nd++] = (char)('0' + u % 10);
+            u /= 10;
+        } while (u);
+        while (nd > 0)
+        {
+            buf[len++] = digits[--nd];
+        }
+        buf[len++] = (i + 1 == count) ? '\n' : ' ';
+    }
+    if (count == 0)
+    {
+        buf[len++] = '\n';
+    }
+    fwrite(buf, 1, len, fp);
+
+    free(buf);
+    fclose(fp);
+    return 0;
+}
+
+static int write_binary(const char *path, const int *data, int count)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        perror("Failed to open binary output file");
+        return -1;
+    }
+
+    struct bin_header hdr;
+    memcpy(hdr.magic, BIN_MAGIC, 4);
+    hdr.version = BIN_VERSION;
+    hdr.count = (uint64_t)count;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        (count > 0 && fwrite(data, sizeof(int), (size_t)count, fp) != (size_t)count))
+    {
+        fprintf(stderr, "Failed to write binary file: %s\n", path);
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Key-payload records: a 64-bit sort key carrying a 64-bit payload (record
+// index, pointer, packed fields...). Text files hold one "key payload" pair
+// per line; binary files use the same container layout as the int format
+// with a distinct magic.
+// ---------------------------------------------------------------------------
+
+#define BIN_MAGIC_KV "BSKV"
+
+struct kv_record
+{
+    int64_t key;
+    int64_t payload;
+};
+
+struct kv_buffer
+{
+    struct kv_record *data;
+    int count;
+    void *map_base;
+    size_t map_len;
+};
+
+static int read_records_text(const char *path, struct kv_buffer *in)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        perror("Failed to open input file");
+        return -1;
+    }
+
+    int capacity = 1024;
+    int size = 0;
+    struct kv_record *buffer = malloc(capacity * sizeof(*buffer));
+    if (!buffer)
+    {
+        fclose(fp);
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    while (1)
+    {
+        long long key, payload;
+        int scanned = fscanf(fp, "%lld %lld", &key, &payload);
+        if (scanned == 2)
+        {
+            if (size == capacity)
+            {
+                capacity *= 2;
+                struct kv_record *tmp = realloc(buffer, capacity * sizeof(*buffer));
+                if (!tmp)
+                {
+                    free(buffer);
+                    fclose(fp);
+                    fprintf(stderr, "Memory allocation failed\n");
+                    return -1;
+                }
+                buffer = tmp;
+            }
+            buffer[size].key = key;
+            buffer[size].payload = payload;
+            ++size;
+        }
+        else if (scanned == EOF)
+        {
+            break;
+        }
+        else
+        {
+            free(buffer);
+            fclose(fp);
+            fprintf(stderr, "Invalid record data in input file\n");
+            return -1;
+        }
+    }
+
+    fclose(fp);
+    in->data = buffer;
+    in->count = size;
+    in->map_base = NULL;
+    in->map_len = 0;
+    return size;
+}
+
+static int read_records_binary(const char *path, struct kv_buffer *in)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Failed to open input file");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        perror("fstat failed on input file");
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap failed on input file");
+        return -1;
+    }
+
+    struct bin_header *hdr = base;
+    if ((size_t)st.st_size < sizeof(*hdr) ||
+        memcmp(hdr->magic, BIN_MAGIC_KV, 4) != 0 || hdr->version != BIN_VERSION ||
+        hdr->count > INT_MAX ||
+        sizeof(*hdr) + hdr->count * sizeof(struct kv_record) > (size_t)st.st_size)
+    {
+        fprintf(stderr, "Not a valid binary record file: %s\n", path);
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    in->data = (struct kv_record *)((char *)base + sizeof(*hdr));
+    in->count = (int)hdr->count;
+    in->map_base = base;
+    in->map_len = (size_t)st.st_size;
+    return in->count;
+}
+
+static int read_records(const char *path, enum input_format format, struct kv_buffer *in)
+{
+    if (format == FORMAT_AUTO)
+    {
+        format = detect_format(path);
+    }
+    if (format == FORMAT_BIN)
+    {
+        return read_records_binary(path, in);
+    }
+    return read_records_text(path, in);
+}
+
+static int kv_buffer_pad(struct kv_buffer *in, int padded_count)
+{
+    if (padded_count <= in->count)
+    {
+        return 0;
+    }
+
+    if (in->map_base)
+    {
+        struct kv_record *copy = malloc(padded_count * sizeof(*copy));
+        if (!copy)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+        memcpy(copy, in->data, in->count * sizeof(*copy));
+        munmap(in->map_base, in->map_len);
+        in->data = copy;
+        in->map_base = NULL;
+        in->map_len = 0;
+    }
+    else
+    {
+        struct kv_record *tmp = realloc(in->data, padded_count * sizeof(*tmp));
+        if (!tmp)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+        in->data = tmp;
+    }
+
+    for (int i = in->count; i < padded_count; ++i)
+    {
+        in->data[i].key = INT64_MAX; // sentinel to keep padding at the end
+        in->data[i].payload = 0;
+    }
+    return 0;
+}
+
+static void kv_buffer_release(struct kv_buffer *in)
+{
+    if (in->map_base)
+    {
+        munmap(in->map_base, in->map_len);
+    }
+    else
+    {
+        free(in->data);
+    }
+    in->data = NULL;
+    in->count = 0;
+    in->map_base = NULL;
+    in->map_len = 0;
+}
+
+static int write_records_text(const char *path, const struct kv_record *data, int count)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+    {
+        perror("Failed to open output file");
+        return -1;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        fprintf(fp, "%lld %lld\n", (long long)data[i].key, (long long)data[i].payload);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static int write_records_binary(const char *path, const struct kv_record *data, int count)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        perror("Failed to open binary output file");
+        return -1;
+    }
+
+    struct bin_header hdr;
+    memcpy(hdr.magic, BIN_MAGIC_KV, 4);
+    hdr.version = BIN_VERSION;
+    hdr.count = (uint64_t)count;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        (count > 0 && fwrite(data, sizeof(*data), (size_t)count, fp) != (size_t)count))
+    {
+        fprintf(stderr, "Failed to write binary file: %s\n", path);
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Result-cache keys: a cache entry is named by a 64-bit FNV-1a hash over
+// the input's path, size, mtime and full content, so an unchanged file maps
+// to the same entry across runs and any edit (even one that preserves size
+// and mtime) changes the key. Hashing is one sequential pass over the raw
+// bytes — far cheaper than parsing, let alone sorting.
+// ---------------------------------------------------------------------------
+
+static uint64_t fnv1a_update(uint64_t h, const void *bytes, size_t len)
+{
+    const unsigned char *p = bytes;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Fills out (at least 17 bytes) with the 16-hex-digit cache key, or
+// returns -1 if the input cannot be read.
+static int compute_cache_key(const char *path, char *out, size_t out_len)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        return -1;
+    }
+
+    uint64_t h = 1469598103934665603ull;
+    h = fnv1a_update(h, path, strlen(path));
+    int64_t size = (int64_t)st.st_size;
+    int64_t mtime = (int64_t)st.st_mtime;
+    h = fnv1a_update(h, &size, sizeof(size));
+    h = fnv1a_update(h, &mtime, sizeof(mtime));
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        return -1;
+    }
+    char chunk[1 << 16];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    {
+        h = fnv1a_update(h, chunk, got);
+    }
+    fclose(fp);
+
+    snprintf(out, out_len, "%016llx", (unsigned long long)h);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Type-specialized I/O, generated once per element type. Text files hold
+// whitespace-separated values as before; binary files reuse the 16-byte
+// container with a per-type magic so a mistyped file is rejected instead of
+// misread. Typed buffers are plain heap allocations (no mmap fast path):
+// the typed modes always pad and sort in place, so copy-on-write loading
+// would buy nothing.
+// ---------------------------------------------------------------------------
+
+#define BIN_MAGIC_I64 "BSI8"
+#define BIN_MAGIC_U32 "BSU4"
+#define BIN_MAGIC_F32 "BSF4"
+#define BIN_MAGIC_F64 "BSF8"
+
+#define DEFINE_TYPED_IO(NAME, T, MAGIC, SCAN_T, SCAN_FMT, PRINT_T, PRINT_FMT)  \
+    struct NAME##_buffer                                                       \
+    {                                                                          \
+        T *data;                                                               \
+        int count;                                                             \
+    };                                                                         \
+                                                                               \
+    static int read_##NAME##_text(const char *path, struct NAME##_buffer *in)  \
+    {                                                                          \
+        FILE *fp = fopen(path, "r");                                           \
+        if (!fp)                                                               \
+        {                                                                      \
+            perror("Failed to open input file");                               \
+            return -1;                                                         \
+        }                                                                      \
+        int capacity = 1024;                                                   \
+        int size = 0;                                                          \
+        T *buffer = malloc(capacity * sizeof(T));                              \
+        if (!buffer)                                                           \
+        {                                                                      \
+            fclose(fp);                                                        \
+            fprintf(stderr, "Memory allocation failed\n");                     \
+            return -1;                                                         \
+        }                                                                      \
+        SCAN_T value;                                                          \
+        while (fscanf(fp, SCAN_FMT, &value) == 1)                              \
+        {                                                                      \
+            if (size == capacity)                                              \
+            {                                                                  \
+                capacity *= 2;                                                 \
+                T *tmp = realloc(buffer, capacity * sizeof(T));                \
+                if (!tmp)                                                      \
+                {                                                              \
+                    free(buffer);                                              \
+                    fclose(fp);                                                \
+                    fprintf(stderr, "Memory allocation failed\n");             \
+                    return -1;                                                 \
+                }                                                              \
+                buffer = tmp;                                                  \
+            }                                                                  \
+            buffer[size++] = (T)value;                                         \
+        }                                                                      \
+        fclose(fp);                                                            \
+        if (size == 0)                                                         \
+        {                                                                      \
+            free(buffer);                                                      \
+            fprintf(stderr, "No values found in input file\n");                \
+            return -1;                                                         \
+        }                                                                      \
+        in->data = buffer;                                                     \
+        in->count = size;                                                      \
+        return size;                                                           \
+    }                                                                          \
+                                                                               \
+    static int read_##NAME##_binary(const char *path, struct NAME##_buffer *in)\
+    {                                                                          \
+        FILE *fp = fopen(path, "rb");                                          \
+        if (!fp)                                                               \
+        {                                                                      \
+            perror("Failed to open input file");                               \
+            return -1;                                                         \
+        }                                                                      \
+        struct bin_header hdr;                                                 \
+        if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||                            \
+            memcmp(hdr.magic, MAGIC, 4) != 0 || hdr.version != BIN_VERSION ||  \
+            hdr.count == 0 || hdr.count > INT_MAX)                             \
+        {                                                                      \
+            fprintf(stderr, "Not a valid " #NAME " binary file: %s\n", path);  \
+            fclose(fp);                                                        \
+            return -1;                                                         \
+        }                                                                      \
+        int count = (int)hdr.count;                                            \
+        T *buffer = malloc((size_t)count * sizeof(T));                         \
+        if (!buffer)                                                           \
+        {                                                                      \
+            fclose(fp);                                                        \
+            fprintf(stderr, "Memory allocation failed\n");                     \
+            return -1;                                                         \
+        }                                                                      \
+        if (fread(buffer, sizeof(T), (size_t)count, fp) != (size_t)count)      \
+        {                                                                      \
+            fprintf(stderr, "Truncated binary file: %s\n", path);              \
+            free(buffer);                                                      \
+            fclose(fp);                                                        \
+            return -1;                                                         \
+        }                                                                      \
+        fclose(fp);                                                            \
+        in->data = buffer;                                                     \
+        in->count = count;                                                     \
+        return count;                                                          \
+    }                                                                          \
+                                                                               \
+    static int read_##NAME(const char *path, enum input_format format,         \
+                           struct NAME##_buffer *in)                           \
+    {                                                                          \
+        if (format == FORMAT_AUTO)                                             \
+        {                                                                      \
+            format = detect_format(path);                                      \
+        }                                                                      \
+        return format == FORMAT_BIN ? read_##NAME##_binary(path, in)           \
+                                    : read_##NAME##_text(path, in);            \
+    }                                                                          \
+                                                                               \
+    static int NAME##_buffer_pad(struct NAME##_buffer *in, int padded,         \
+                                 T sentinel)                                   \
+    {                                                                          \
+        if (padded <= in->count)                                               \
+        {                                                                      \
+            return 0;                                                          \
+        }                                                                      \
+        T *grown = realloc(in->data, (size_t)padded * sizeof(T));              \
+        if (!grown)                                                            \
+        {                                                                      \
+            fprintf(stderr, "Memory allocation failed\n");                     \
+            return -1;                                                         \
+        }                                                                      \
+        for (int i = in->count; i < padded; ++i)                               \
+        {                                                                      \
+            grown[i] = sentinel;                                               \
+        }                                                                      \
+        in->data = grown;                                                      \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    static int write_##NAME##_text(const char *path, const T *data, int count) \
+    {                                                                          \
+        FILE *fp = fopen(path, "w");                                           \
+        if (!fp)                                                               \
+        {                                                                      \
+            perror("Failed to open output file");                              \
+            return -1;                                                         \
+        }                                                                      \
+        for (int i = 0; i < count; ++i)                                        \
+        {                                                                      \
+            fprintf(fp, i ? " " PRINT_FMT : PRINT_FMT, (PRINT_T)data[i]);      \
+        }                                                                      \
+        fputc('\n', fp);                                                       \
+        fclose(fp);                                                            \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    static int write_##NAME##_binary(const char *path, const T *data,          \
+                                     int count)                                \
+    {                                                                          \
+        FILE *fp = fopen(path, "wb");                                          \
+        if (!fp)                                                               \
+        {                                                                      \
+            perror("Failed to open binary output file");                       \
+            return -1;                                                         \
+        }                                                                      \
+        struct bin_header hdr;                                                 \
+        memcpy(hdr.magic, MAGIC, 4);                                           \
+        hdr.version = BIN_VERSION;                                             \
+        hdr.count = (uint64_t)count;                                           \
+        if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||                           \
+            (count > 0 &&                                                      \
+             fwrite(data, sizeof(T), (size_t)count, fp) != (size_t)count))     \
+        {                                                                      \
+            fprintf(stderr, "Failed to write binary file: %s\n", path);        \
+            fclose(fp);                                                        \
+            return -1;                                                         \
+        }                                                                      \
+        fclose(fp);                                                            \
+        return 0;                                                              \
+    }
+
+DEFINE_TYPED_IO(i64, int64_t, BIN_MAGIC_I64, long long, "%lld", long long, "%lld")
+DEFINE_TYPED_IO(u32, uint32_t, BIN_MAGIC_U32, unsigned long, "%lu", unsigned, "%u")
+DEFINE_TYPED_IO(f32, float, BIN_MAGIC_F32, float, "%f", double, "%.9g")
+DEFINE_TYPED_IO(f64, double, BIN_MAGIC_F64, double, "%lf", double, "%.17g")
+
+#endif // BITONIC_IO_H
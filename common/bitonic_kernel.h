@@ -0,0 +1,1037 @@
+#ifndef BITONIC_KERNEL_H
+#define BITONIC_KERNEL_H
+
+// Shared-memory bitonic sort kernels used by both the OpenMP binary and the
+// threaded local-sort phase of the MPI binary. Requires OpenMP.
+
+#include "bitonic_io.h"
+
+#include <omp.h>
+
+// Elements per cache block for the fused inner stages. 16K ints (64 KiB)
+// keeps a block plus its partner lines comfortably inside a 256 KiB L2.
+#define CACHE_BLOCK_ELEMS (1 << 14)
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Compare-exchange data[i] with data[i + j] for i in [start, start + len):
+// the smaller value goes to the lower index when ascending. For j >= 8 the
+// i and i + j runs are contiguous, which makes this a straight min/max
+// vector kernel; the implementation is picked once at runtime via cpuid.
+static void compare_run_scalar(int *data, int start, int j, int len, int ascending)
+{
+    for (int i = start; i < start + len; ++i)
+    {
+        if ((data[i] > data[i + j]) == ascending)
+        {
+            int tmp = data[i];
+            data[i] = data[i + j];
+            data[i + j] = tmp;
+        }
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2"))) static void compare_run_avx2(int *data, int start, int j, int len, int ascending)
+{
+    int i = start;
+    int end = start + len;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)&data[i]);
+        __m256i b = _mm256_loadu_si256((const __m256i *)&data[i + j]);
+        __m256i lo = _mm256_min_epi32(a, b);
+        __m256i hi = _mm256_max_epi32(a, b);
+        if (ascending)
+        {
+            _mm256_storeu_si256((__m256i *)&data[i], lo);
+            _mm256_storeu_si256((__m256i *)&data[i + j], hi);
+        }
+        else
+        {
+            _mm256_storeu_si256((__m256i *)&data[i], hi);
+            _mm256_storeu_si256((__m256i *)&data[i + j], lo);
+        }
+    }
+    for (; i < end; ++i)
+    {
+        if ((data[i] > data[i + j]) == ascending)
+        {
+            int tmp = data[i];
+            data[i] = data[i + j];
+            data[i + j] = tmp;
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) static void compare_run_avx512(int *data, int start, int j, int len, int ascending)
+{
+    int i = start;
+    int end = start + len;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m512i a = _mm512_loadu_si512(&data[i]);
+        __m512i b = _mm512_loadu_si512(&data[i + j]);
+        __m512i lo = _mm512_min_epi32(a, b);
+        __m512i hi = _mm512_max_epi32(a, b);
+        if (ascending)
+        {
+            _mm512_storeu_si512(&data[i], lo);
+            _mm512_storeu_si512(&data[i + j], hi);
+        }
+        else
+        {
+            _mm512_storeu_si512(&data[i], hi);
+            _mm512_storeu_si512(&data[i + j], lo);
+        }
+    }
+    for (; i < end; ++i)
+    {
+        if ((data[i] > data[i + j]) == ascending)
+        {
+            int tmp = data[i];
+            data[i] = data[i + j];
+            data[i + j] = tmp;
+        }
+    }
+}
+#endif // HAVE_X86_SIMD
+
+// Optional per-stage timing for --profile. Indexed by (log2 k, log2 j);
+// a fused cache-blocked pass is charged to its entry stage. Costs one
+// omp_get_wtime pair per stage sweep when enabled, nothing when not.
+static int kernel_profile_enabled = 0;
+static double kernel_stage_seconds[32][32];
+
+static int ilog2(int n)
+{
+    int l = 0;
+    while (n > 1)
+    {
+        n >>= 1;
+        ++l;
+    }
+    return l;
+}
+
+static void kernel_profile_reset(void)
+{
+    for (int a = 0; a < 32; ++a)
+    {
+        for (int b = 0; b < 32; ++b)
+        {
+            kernel_stage_seconds[a][b] = 0.0;
+        }
+    }
+}
+
+static void kernel_profile_report(void)
+{
+    printf("profile_csv,section,k_log2,j_log2,seconds\n");
+    for (int a = 0; a < 32; ++a)
+    {
+        for (int b = 0; b < 32; ++b)
+        {
+            if (kernel_stage_seconds[a][b] > 0.0)
+            {
+                printf("profile_csv,stage,%d,%d,%.6f\n", a, b, kernel_stage_seconds[a][b]);
+            }
+        }
+    }
+}
+
+typedef void (*compare_run_fn)(int *, int, int, int, int);
+static compare_run_fn compare_run = NULL;
+
+static void select_compare_run(void)
+{
+    compare_run = compare_run_scalar;
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        compare_run = compare_run_avx512;
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        compare_run = compare_run_avx2;
+    }
+#endif
+}
+
+// Run all remaining j-stages of the current k-phase inside one aligned
+// block. Once 2*j <= block size, every comparator partner i^j lands in the
+// same block, so the whole tail of the phase is a single in-cache pass
+// instead of one DRAM sweep per stage.
+static void bitonic_merge_block(int *data, int k, int j_start, int start, int block)
+{
+    for (int j = j_start; j > 0; j >>= 1)
+    {
+        if (j >= 8)
+        {
+            // Comparators form contiguous runs of length j: hand each run
+            // to the vector kernel. The direction bit k is constant per run.
+            for (int base = start; base < start + block; base += 2 * j)
+            {
+                compare_run(data, base, j, j, (base & k) == 0);
+            }
+            continue;
+        }
+
+        for (int i = start; i < start + block; ++i)
+        {
+            int ixj = i ^ j;
+            if (ixj > i)
+            {
+                int ascending = ((i & k) == 0);
+                if ((data[i] > data[ixj]) == ascending)
+                {
+                    int tmp = data[i];
+                    data[i] = data[ixj];
+                    data[ixj] = tmp;
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Arbitrary-n bitonic sort (Lang's network). Used when n is not a power of
+// two, so callers can skip the next_power_of_two realloc and sentinel fill
+// entirely. The comparator loop of each merge level is a contiguous run
+// with a fixed stride and direction, so it maps straight onto compare_run.
+// ---------------------------------------------------------------------------
+
+static int greatest_power_of_two_below(int n)
+{
+    int p = 1;
+    while (p << 1 < n)
+    {
+        p <<= 1;
+    }
+    return p;
+}
+
+static void bitonic_merge_any(int *data, int lo, int n, int ascending)
+{
+    if (n <= 1)
+    {
+        return;
+    }
+
+    int m = greatest_power_of_two_below(n);
+    int len = n - m;
+    if (len > 2 * CACHE_BLOCK_ELEMS)
+    {
+        // Chunk the top-level comparator run into tasks so it does not
+        // serialize the merge tree.
+        for (int c = 0; c < len; c += CACHE_BLOCK_ELEMS)
+        {
+            int clen = len - c < CACHE_BLOCK_ELEMS ? len - c : CACHE_BLOCK_ELEMS;
+#pragma omp task firstprivate(c, clen)
+            compare_run(data, lo + c, m, clen, ascending);
+        }
+#pragma omp taskwait
+    }
+    else
+    {
+        compare_run(data, lo, m, len, ascending);
+    }
+
+    if (n > CACHE_BLOCK_ELEMS)
+    {
+#pragma omp task
+        bitonic_merge_any(data, lo, m, ascending);
+#pragma omp task
+        bitonic_merge_any(data, lo + m, n - m, ascending);
+#pragma omp taskwait
+    }
+    else
+    {
+        bitonic_merge_any(data, lo, m, ascending);
+        bitonic_merge_any(data, lo + m, n - m, ascending);
+    }
+}
+
+static void bitonic_sort_any(int *data, int lo, int n, int ascending)
+{
+    if (n <= 1)
+    {
+        return;
+    }
+
+    int m = n / 2;
+    if (n > CACHE_BLOCK_ELEMS)
+    {
+#pragma omp task
+        bitonic_sort_any(data, lo, m, !ascending);
+#pragma omp task
+        bitonic_sort_any(data, lo + m, n - m, ascending);
+#pragma omp taskwait
+    }
+    else
+    {
+        bitonic_sort_any(data, lo, m, !ascending);
+        bitonic_sort_any(data, lo + m, n - m, ascending);
+    }
+    bitonic_merge_any(data, lo, n, ascending);
+}
+
+static void bitonic_sort_arbitrary(int *data, int n)
+{
+    if (!compare_run)
+    {
+        select_compare_run();
+    }
+#pragma omp parallel
+#pragma omp single
+    bitonic_sort_any(data, 0, n, 1);
+}
+
+static void bitonic_sort(int *data, int n)
+{
+    if (!compare_run)
+    {
+        select_compare_run();
+    }
+
+    // The iterative schedule below assumes a power-of-two n; anything else
+    // goes through the arbitrary-n network.
+    if (n & (n - 1))
+    {
+        bitonic_sort_arbitrary(data, n);
+        return;
+    }
+
+    int block = CACHE_BLOCK_ELEMS;
+    if (block > n)
+    {
+        block = n;
+    }
+    int num_blocks = n / block;
+
+    for (int k = 2; k <= n; k <<= 1)
+    {
+        for (int j = k >> 1; j > 0; j >>= 1)
+        {
+            double stage_start = kernel_profile_enabled ? omp_get_wtime() : 0.0;
+
+            if (2 * j <= block)
+            {
+                // Fuse stages j, j/2, ..., 1 of this phase into one pass
+                // per block while the data is hot.
+#pragma omp parallel for schedule(static)
+                for (int b = 0; b < num_blocks; ++b)
+                {
+                    bitonic_merge_block(data, k, j, b * block, block);
+                }
+                if (kernel_profile_enabled)
+                {
+                    kernel_stage_seconds[ilog2(k)][ilog2(j)] += omp_get_wtime() - stage_start;
+                }
+                break;
+            }
+
+            // Unfused sweep: one run of j comparators per 2j elements.
+            int num_runs = n / (2 * j);
+#pragma omp parallel for schedule(static)
+            for (int r = 0; r < num_runs; ++r)
+            {
+                int base = r * 2 * j;
+                compare_run(data, base, j, j, (base & k) == 0);
+            }
+
+            if (kernel_profile_enabled)
+            {
+                kernel_stage_seconds[ilog2(k)][ilog2(j)] += omp_get_wtime() - stage_start;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GPU engine: the whole (k, j) schedule runs inside one target data region,
+// so the array crosses the bus exactly once each way and every sweep is a
+// flat, branch-uniform device kernel over n/2 comparators. The oblivious
+// schedule needs no device-side synchronization beyond the per-sweep kernel
+// boundary. Requires a power-of-two n; callers pad as for the iterative
+// schedule.
+// ---------------------------------------------------------------------------
+
+static int gpu_available(void)
+{
+    return omp_get_num_devices() > 0;
+}
+
+static void bitonic_sort_gpu(int *data, int n)
+{
+#pragma omp target data map(tofrom : data[0 : n])
+    {
+        for (int k = 2; k <= n; k <<= 1)
+        {
+            for (int j = k >> 1; j > 0; j >>= 1)
+            {
+#pragma omp target teams distribute parallel for
+                for (int i = 0; i < n; ++i)
+                {
+                    int partner = i ^ j;
+                    if (partner > i)
+                    {
+                        int ascending = ((i & k) == 0);
+                        int a = data[i];
+                        int b = data[partner];
+                        if ((a > b) == ascending)
+                        {
+                            data[i] = b;
+                            data[partner] = a;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Key-payload variant of the iterative kernel: the comparator orders on the
+// 64-bit key and the payload rides along in the same pass, so no scattered
+// permutation gather is needed afterwards. Same phase structure and cache
+// blocking as the int kernel; comparators are scalar since each record is a
+// full 16 bytes.
+// ---------------------------------------------------------------------------
+
+static void bitonic_merge_block_kv(struct kv_record *data, int k, int j_start, int start, int block)
+{
+    for (int j = j_start; j > 0; j >>= 1)
+    {
+        for (int i = start; i < start + block; ++i)
+        {
+            int ixj = i ^ j;
+            if (ixj > i)
+            {
+                int ascending = ((i & k) == 0);
+                if ((data[i].key > data[ixj].key) == ascending)
+                {
+                    struct kv_record tmp = data[i];
+                    data[i] = data[ixj];
+                    data[ixj] = tmp;
+                }
+            }
+        }
+    }
+}
+
+// Requires a power-of-two n; callers pad with key = INT64_MAX sentinels.
+static void bitonic_sort_kv(struct kv_record *data, int n)
+{
+    int block = CACHE_BLOCK_ELEMS / 4; // records are 4x the size of an int
+    if (block > n)
+    {
+        block = n;
+    }
+    int num_blocks = n / block;
+
+    for (int k = 2; k <= n; k <<= 1)
+    {
+        for (int j = k >> 1; j > 0; j >>= 1)
+        {
+            if (2 * j <= block)
+            {
+#pragma omp parallel for schedule(static)
+                for (int b = 0; b < num_blocks; ++b)
+                {
+                    bitonic_merge_block_kv(data, k, j, b * block, block);
+                }
+                break;
+            }
+
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; ++i)
+            {
+                int ixj = i ^ j;
+                if (ixj > i)
+                {
+                    int ascending = ((i & k) == 0);
+                    if ((data[i].key > data[ixj].key) == ascending)
+                    {
+                        struct kv_record tmp = data[i];
+                        data[i] = data[ixj];
+                        data[ixj] = tmp;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Type-specialized kernels, generated once per element type. Each instance
+// carries the same phase structure and cache blocking as the int kernel
+// with the comparator fully inlined for its type — no function-pointer
+// comparison anywhere on the hot path. The cache block is scaled by the
+// element size so a block still spans the same number of bytes.
+// ---------------------------------------------------------------------------
+
+#define DEFINE_BITONIC_SORT_TYPE(NAME, T, BLOCK_DIV)                           \
+    static void bitonic_merge_block_##NAME(T *data, int k, int j_start,        \
+                                           int start, int block)               \
+    {                                                                          \
+        for (int j = j_start; j > 0; j >>= 1)                                  \
+        {                                                                      \
+            for (int i = start; i < start + block; ++i)                        \
+            {                                                                  \
+                int ixj = i ^ j;                                               \
+                if (ixj > i)                                                   \
+                {                                                              \
+                    int ascending = ((i & k) == 0);                            \
+                    if ((data[i] > data[ixj]) == ascending)                    \
+                    {                                                          \
+                        T tmp = data[i];                                       \
+                        data[i] = data[ixj];                                   \
+                        data[ixj] = tmp;                                       \
+                    }                                                          \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Requires a power-of-two n; callers pad with the type's sentinel. */     \
+    static void bitonic_sort_##NAME(T *data, int n)                            \
+    {                                                                          \
+        int block = CACHE_BLOCK_ELEMS / (BLOCK_DIV);                           \
+        if (block > n)                                                         \
+        {                                                                      \
+            block = n;                                                         \
+        }                                                                      \
+        int num_blocks = n / block;                                            \
+                                                                               \
+        for (int k = 2; k <= n; k <<= 1)                                       \
+        {                                                                      \
+            for (int j = k >> 1; j > 0; j >>= 1)                               \
+            {                                                                  \
+                if (2 * j <= block)                                            \
+                {                                                              \
+                    _Pragma("omp parallel for schedule(static)")               \
+                    for (int b = 0; b < num_blocks; ++b)                       \
+                    {                                                          \
+                        bitonic_merge_block_##NAME(data, k, j, b * block,      \
+                                                   block);                     \
+                    }                                                          \
+                    break;                                                     \
+                }                                                              \
+                                                                               \
+                _Pragma("omp parallel for schedule(static)")                   \
+                for (int i = 0; i < n; ++i)                                    \
+                {                                                              \
+                    int ixj = i ^ j;                                           \
+                    if (ixj > i)                                               \
+                    {                                                          \
+                        int ascending = ((i & k) == 0);                        \
+                        if ((data[i] > data[ixj]) == ascending)                \
+                        {                                                      \
+                            T tmp = data[i];                                   \
+                            data[i] = data[ixj];                               \
+                            data[ixj] = tmp;                                   \
+                        }                                                      \
+                    }                                                          \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+    }
+
+DEFINE_BITONIC_SORT_TYPE(i64, int64_t, 2)
+DEFINE_BITONIC_SORT_TYPE(u32, uint32_t, 1)
+DEFINE_BITONIC_SORT_TYPE(f32, float, 1)
+DEFINE_BITONIC_SORT_TYPE(f64, double, 2)
+
+// Merge two sorted arrays into out using all available threads. The output
+// range is split evenly and each thread finds its start position in a and b
+// with a co-rank binary search, so no thread touches another's output.
+static void merge_sorted_parallel(const int *a, int na, const int *b, int nb, int *out)
+{
+#pragma omp parallel
+    {
+        int nt = omp_get_num_threads();
+        int t = omp_get_thread_num();
+        long total = (long)na + nb;
+        long out_lo = total * t / nt;
+        long out_hi = total * (t + 1) / nt;
+
+        // Co-rank search: find ia in [lo, hi] such that taking ia elements
+        // from a and out_lo - ia from b is a valid merge frontier (ties go
+        // to a first).
+        long lo = out_lo - nb > 0 ? out_lo - nb : 0;
+        long hi = out_lo < na ? out_lo : na;
+        while (lo < hi)
+        {
+            long mid = (lo + hi) / 2;
+            if (a[mid] <= b[out_lo - mid - 1])
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        long ia = lo;
+        long ib = out_lo - ia;
+        for (long o = out_lo; o < out_hi; ++o)
+        {
+            if (ib >= nb || (ia < na && a[ia] <= b[ib]))
+            {
+                out[o] = a[ia++];
+            }
+            else
+            {
+                out[o] = b[ib++];
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Top-K selection: each thread streams its static chunk through a bounded
+// max-heap of the K smallest values it has seen, then the per-thread
+// candidates (at most threads * K of them) are sorted and trimmed to K.
+// O(n log K) work and K values of output instead of a full sort.
+// ---------------------------------------------------------------------------
+
+// Restores the max-heap property below node i; the root holds the worst
+// of the current candidates, so admission is a single compare against it.
+static void topk_sift_down(int *heap, int size, int i)
+{
+    for (;;)
+    {
+        int largest = i;
+        int l = 2 * i + 1;
+        int r = 2 * i + 2;
+        if (l < size && heap[l] > heap[largest])
+        {
+            largest = l;
+        }
+        if (r < size && heap[r] > heap[largest])
+        {
+            largest = r;
+        }
+        if (largest == i)
+        {
+            break;
+        }
+        int swap = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = swap;
+        i = largest;
+    }
+}
+
+static int topk_int_compare(const void *pa, const void *pb)
+{
+    int a = *(const int *)pa;
+    int b = *(const int *)pb;
+    return (a > b) - (a < b);
+}
+
+// Writes the min(k, n) smallest values of data into out, ascending, and
+// returns how many were written.
+static int topk_select(const int *data, int n, int k, int *out)
+{
+    if (k > n)
+    {
+        k = n;
+    }
+    if (k <= 0)
+    {
+        return 0;
+    }
+
+    int nt = omp_get_max_threads();
+    int *heaps = malloc((size_t)nt * k * sizeof(int));
+    int *sizes = calloc(nt, sizeof(int));
+    if (!heaps || !sizes)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int *heap = heaps + (size_t)t * k;
+        int hs = 0;
+#pragma omp for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            int v = data[i];
+            if (hs < k)
+            {
+                heap[hs++] = v;
+                if (hs == k)
+                {
+                    for (int node = k / 2 - 1; node >= 0; --node)
+                    {
+                        topk_sift_down(heap, k, node);
+                    }
+                }
+            }
+            else if (v < heap[0])
+            {
+                heap[0] = v;
+                topk_sift_down(heap, k, 0);
+            }
+        }
+        sizes[t] = hs;
+    }
+
+    // Candidate pool is tiny next to n; a serial sort-and-trim is enough.
+    int total = 0;
+    for (int t = 0; t < nt; ++t)
+    {
+        memmove(heaps + total, heaps + (size_t)t * k, sizes[t] * sizeof(int));
+        total += sizes[t];
+    }
+    qsort(heaps, total, sizeof(int), topk_int_compare);
+
+    memcpy(out, heaps, k * sizeof(int));
+    free(heaps);
+    free(sizes);
+    return k;
+}
+
+// Merges two ascending candidate lists, keeping only the k smallest.
+static int topk_merge(const int *a, int na, const int *b, int nb, int k, int *out)
+{
+    int ia = 0;
+    int ib = 0;
+    int o = 0;
+    while (o < k && (ia < na || ib < nb))
+    {
+        if (ib >= nb || (ia < na && a[ia] <= b[ib]))
+        {
+            out[o++] = a[ia++];
+        }
+        else
+        {
+            out[o++] = b[ib++];
+        }
+    }
+    return o;
+}
+
+// ---------------------------------------------------------------------------
+// Adaptive dispatch: bitonic sort is oblivious, so a fully sorted input
+// costs the same (log n)^2 schedule as a random one. A cheap parallel
+// descent count classifies the input first: zero descents exits
+// immediately, a small number of long presorted runs goes through
+// log(runs) rounds of pairwise run merging, and everything else falls
+// through to the regular bitonic schedule.
+// ---------------------------------------------------------------------------
+
+#define ADAPTIVE_MAX_RUNS 256
+
+// Number of positions where order is violated; 0 means already sorted.
+static long count_descents(const int *data, int n)
+{
+    long descents = 0;
+#pragma omp parallel for schedule(static) reduction(+ : descents)
+    for (int i = 0; i < n - 1; ++i)
+    {
+        descents += data[i] > data[i + 1];
+    }
+    return descents;
+}
+
+// Merges the m presorted runs delimited by bounds[0..m] (bounds[0] = 0,
+// bounds[m] = n) with pairwise rounds of the threaded merge, halving the
+// run count per round. bounds is rewritten in place as runs coalesce.
+static void merge_runs(int *data, int n, int *bounds, int m)
+{
+    int *tmp = malloc(n * sizeof(int));
+    if (!tmp)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    int *src = data;
+    int *dst = tmp;
+    while (m > 1)
+    {
+        int next_m = 0;
+        for (int r = 0; r < m; r += 2)
+        {
+            int lo = bounds[r];
+            if (r + 1 < m)
+            {
+                int mid = bounds[r + 1];
+                int hi = bounds[r + 2];
+                merge_sorted_parallel(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+                bounds[++next_m] = hi;
+            }
+            else
+            {
+                // Odd run out: carried over unchanged.
+                memcpy(dst + lo, src + lo, (bounds[r + 1] - lo) * sizeof(int));
+                bounds[++next_m] = bounds[r + 1];
+            }
+        }
+        m = next_m;
+        int *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != data)
+    {
+        memcpy(data, src, n * sizeof(int));
+    }
+    free(tmp);
+}
+
+// Sortedness-aware front end for bitonic_sort.
+static void bitonic_sort_adaptive(int *data, int n)
+{
+    if (n < 2)
+    {
+        return;
+    }
+
+    long descents = count_descents(data, n);
+    if (descents == 0)
+    {
+        return;
+    }
+
+    // descents + 1 ascending runs; only take the run-merge path when the
+    // runs are long enough that log(runs) merge rounds beat the schedule.
+    if (descents + 1 <= ADAPTIVE_MAX_RUNS)
+    {
+        int m = 0;
+        int *bounds = malloc((descents + 2) * sizeof(int));
+        if (!bounds)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        bounds[m++] = 0;
+        for (int i = 0; i < n - 1; ++i)
+        {
+            if (data[i] > data[i + 1])
+            {
+                bounds[m++] = i + 1;
+            }
+        }
+        bounds[m] = n;
+        merge_runs(data, n, bounds, m);
+        free(bounds);
+        return;
+    }
+
+    bitonic_sort(data, n);
+}
+
+// ---------------------------------------------------------------------------
+// Low-cardinality engine: production columns often hold under a thousand
+// distinct values across hundreds of millions of rows, where the full
+// comparator schedule is pure waste. A small strided sample estimates the
+// cardinality; when it is low the data goes through per-thread hash
+// histograms, a value-sorted prefix sum and one parallel emit — a single
+// O(n) pass. If the sample or either histogram pass discovers too many
+// distinct values the caller falls back to the bitonic schedule, so the
+// pre-pass can never produce a wrong result, only skip the shortcut.
+// ---------------------------------------------------------------------------
+
+#define CARDINALITY_SAMPLE 4096
+#define CARDINALITY_MAX_DISTINCT 1024
+#define CARDINALITY_TABLE_CAP 4096 // power of two, 4x max distinct
+
+struct card_entry
+{
+    int value;
+    long count; // 0 marks an empty slot; occupied entries are never 0
+};
+
+static int card_entry_compare(const void *pa, const void *pb)
+{
+    int a = ((const struct card_entry *)pa)->value;
+    int b = ((const struct card_entry *)pb)->value;
+    return (a > b) - (a < b);
+}
+
+// Open-addressing insert; returns -1 when the table is full, which the
+// caller treats as "cardinality too high after all".
+static int card_table_add(struct card_entry *table, int value, long add)
+{
+    uint32_t h = (uint32_t)value * 2654435761u;
+    for (int probe = 0; probe < CARDINALITY_TABLE_CAP; ++probe)
+    {
+        int idx = (int)((h + probe) & (CARDINALITY_TABLE_CAP - 1));
+        if (table[idx].count == 0)
+        {
+            table[idx].value = value;
+            table[idx].count = add;
+            return 0;
+        }
+        if (table[idx].value == value)
+        {
+            table[idx].count += add;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Sorts data in place in one O(n) pass when the distinct-value count is
+// low; returns 0 without touching the data when it is not.
+static int counting_sort_try(int *data, int n)
+{
+    if (n < 2 * CARDINALITY_SAMPLE)
+    {
+        return 0; // too small for the shortcut to pay for itself
+    }
+
+    // Strided sample: with <= 1024 true distinct values, 4096 probes see
+    // essentially all of them, so a high sample cardinality is a cheap
+    // early rejection.
+    int sample[CARDINALITY_SAMPLE];
+    int stride = n / CARDINALITY_SAMPLE;
+    for (int i = 0; i < CARDINALITY_SAMPLE; ++i)
+    {
+        sample[i] = data[(long)i * stride];
+    }
+    qsort(sample, CARDINALITY_SAMPLE, sizeof(int), topk_int_compare);
+    int distinct = 1;
+    for (int i = 1; i < CARDINALITY_SAMPLE; ++i)
+    {
+        distinct += sample[i] != sample[i - 1];
+    }
+    if (distinct > CARDINALITY_MAX_DISTINCT)
+    {
+        return 0;
+    }
+
+    int nt = omp_get_max_threads();
+    struct card_entry *tables = calloc((size_t)nt * CARDINALITY_TABLE_CAP, sizeof(*tables));
+    if (!tables)
+    {
+        return 0; // shortcut is optional; let the caller sort normally
+    }
+
+    int failed = 0;
+#pragma omp parallel reduction(| : failed)
+    {
+        struct card_entry *mine = tables + (size_t)omp_get_thread_num() * CARDINALITY_TABLE_CAP;
+#pragma omp for schedule(static)
+        for (int i = 0; i < n; ++i)
+        {
+            if (!failed && card_table_add(mine, data[i], 1) != 0)
+            {
+                failed = 1;
+            }
+        }
+    }
+
+    // Merge the per-thread histograms into thread 0's table; the union can
+    // still overflow if the sample missed rare values.
+    for (int t = 1; t < nt && !failed; ++t)
+    {
+        struct card_entry *theirs = tables + (size_t)t * CARDINALITY_TABLE_CAP;
+        for (int s = 0; s < CARDINALITY_TABLE_CAP && !failed; ++s)
+        {
+            if (theirs[s].count != 0 &&
+                card_table_add(tables, theirs[s].value, theirs[s].count) != 0)
+            {
+                failed = 1;
+            }
+        }
+    }
+    if (failed)
+    {
+        free(tables);
+        return 0;
+    }
+
+    // Compact, order by value, prefix-sum into output offsets, then emit
+    // each value's run; runs are independent so the emit parallelizes.
+    int entries = 0;
+    for (int s = 0; s < CARDINALITY_TABLE_CAP; ++s)
+    {
+        if (tables[s].count != 0)
+        {
+            tables[entries++] = tables[s];
+        }
+    }
+    qsort(tables, entries, sizeof(*tables), card_entry_compare);
+
+    long offset = 0;
+    long *starts = malloc(entries * sizeof(long));
+    if (!starts)
+    {
+        free(tables);
+        return 0;
+    }
+    for (int e = 0; e < entries; ++e)
+    {
+        starts[e] = offset;
+        offset += tables[e].count;
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int e = 0; e < entries; ++e)
+    {
+        int value = tables[e].value;
+        long lo = starts[e];
+        long hi = lo + tables[e].count;
+        for (long i = lo; i < hi; ++i)
+        {
+            data[i] = value;
+        }
+    }
+
+    free(starts);
+    free(tables);
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Verification: an order-independent multiset fingerprint (sum, xor and
+// sum of squares over the values) taken before and after sorting, plus the
+// descent count for monotonicity. One parallel pass each, so a full
+// validation runs at memory bandwidth instead of a text diff. Catches
+// dropped, duplicated or truncated elements that a sortedness check alone
+// would miss.
+// ---------------------------------------------------------------------------
+
+struct verify_sums
+{
+    uint64_t sum;
+    uint64_t xor_all;
+    uint64_t sum_sq;
+};
+
+static struct verify_sums checksum_multiset(const int *data, int n)
+{
+    uint64_t sum = 0;
+    uint64_t xor_all = 0;
+    uint64_t sum_sq = 0;
+#pragma omp parallel for schedule(static) reduction(+ : sum, sum_sq) reduction(^ : xor_all)
+    for (int i = 0; i < n; ++i)
+    {
+        uint64_t v = (uint32_t)data[i];
+        sum += v;
+        xor_all ^= v;
+        sum_sq += v * v;
+    }
+    struct verify_sums s = {sum, xor_all, sum_sq};
+    return s;
+}
+
+static int verify_sums_equal(struct verify_sums a, struct verify_sums b)
+{
+    return a.sum == b.sum && a.xor_all == b.xor_all && a.sum_sq == b.sum_sq;
+}
+
+#endif // BITONIC_KERNEL_H
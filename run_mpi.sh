@@ -5,19 +5,22 @@ INPUT=${1:-InputFiles/input.txt}
 EXE=MPI/bitonic_mpi
 RESULTS=OutputFiles/mpi_times.txt
 MPI_RUN_OPTS=${MPI_RUN_OPTS:---oversubscribe}
+MPI_THREADS=${MPI_THREADS:-1 2 4}
 
 mkdir -p OutputFiles
 
 echo "Building MPI version..."
-mpicc -O2 -std=c11 MPI/bitonic_mpi.c -o "$EXE"
+mpicc -O2 -std=c11 -fopenmp MPI/bitonic_mpi.c -o "$EXE" -lm
 
 echo "Input file: $INPUT" > "$RESULTS"
 for p in 1 2 4 8 16; do
-    echo "Running with $p process(es)..."
-    run_output=$(mpirun $MPI_RUN_OPTS -np "$p" "$EXE" "$INPUT")
-    echo "$run_output"
-    exec_time=$(echo "$run_output" | awk '/Execution time/ {print $4}')
-    echo "$p $exec_time" >> "$RESULTS"
+    for t in $MPI_THREADS; do
+        echo "Running with $p process(es), $t thread(s) per rank..."
+        run_output=$(mpirun $MPI_RUN_OPTS -np "$p" "$EXE" --threads="$t" "$INPUT")
+        echo "$run_output"
+        exec_time=$(echo "$run_output" | awk '/Execution time/ {print $4}')
+        echo "$p $t $exec_time" >> "$RESULTS"
+    done
 done
 
 echo "Execution times saved to $RESULTS"
@@ -10,7 +10,7 @@ mkdir -p OutputFiles
 echo "Building OpenMP version..."
 CC=${CC:-clang}
 OMP_FLAGS="-Xpreprocessor -fopenmp -I/opt/homebrew/opt/libomp/include -L/opt/homebrew/opt/libomp/lib -lomp"
-"$CC" -O2 -std=c11 $OMP_FLAGS OpenMP/bitonic_openmp.c -o "$EXE"
+"$CC" -O2 -std=c11 $OMP_FLAGS OpenMP/bitonic_openmp.c -o "$EXE" -lm
 
 echo "Input file: $INPUT" > "$RESULTS"
 for t in 1 2 4 8 16; do